@@ -0,0 +1,327 @@
+#pragma once
+
+/*
+asset package (.wpak), many files in one so a cold start opens and maps a single file instead of stat-ing and reading each:
+
+    Header
+    Entry[Header.EntryCount]   (sorted by PathHash, then path, for binary search)
+    path table                 (Header.PathBytes of nul terminated paths, Entry.PathOffset into it)
+    payloads, each aligned to BlobAlignment
+
+entries are stored as is, so their payload can be used straight out of a memory mapping, unless compressing saves enough to be
+worth a decode (see compress()). paths are relative with forward slashes, see normalizePath()
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "mapped_file.h"
+
+namespace AssetPackage {
+    const uint32_t Magic = 0x4B415057; //"WPAK"
+    const uint32_t Version = 1;
+    const uint64_t BlobAlignment = 64;
+    const std::string Extension = ".wpak";
+
+    enum Compression : uint32_t {
+        CompressionNone = 0,
+        CompressionLZ = 1, //see compress()
+    };
+
+    struct Header {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t EntryCount;
+        uint32_t PathBytes;
+    };
+
+    struct Entry {
+        uint64_t PathHash; //of the normalized path
+        uint64_t Offset; //of the payload, from the start of the file
+        uint64_t StoredSize; //payload bytes
+        uint64_t Size; //once decompressed
+        uint32_t PathOffset; //into the path table
+        uint32_t Compression;
+    };
+
+    inline uint64_t hash(const char* text, size_t length) { //64 bit FNV-1a
+        uint64_t result = 14695981039346656037ull;
+        for (size_t i = 0; i < length; i++) {
+            result = (result ^ (unsigned char)text[i]) * 1099511628211ull;
+        }
+        return result;
+    }
+
+    inline std::string normalizePath(std::string path) { //forward slashes, no leading "./"
+        std::replace(path.begin(), path.end(), '\\', '/');
+        while (path.compare(0, 2, "./") == 0) {
+            path = path.substr(2);
+        }
+        return path;
+    }
+
+    inline const Entry* getEntries(const Header* header) {
+        return (const Entry*)(header + 1);
+    }
+
+    inline const char* getPaths(const Header* header) {
+        return (const char*)(getEntries(header) + header->EntryCount);
+    }
+
+    //returns the header if data holds a well-formed package, NULL otherwise
+    inline const Header* validate(const unsigned char* data, size_t size) {
+        if (data == NULL || size < sizeof(Header)) {
+            return NULL;
+        }
+        const Header* header = (const Header*)data;
+        if (header->Magic != Magic || header->Version != Version) {
+            return NULL;
+        }
+        uint64_t paths_end = sizeof(Header) + (uint64_t)header->EntryCount * sizeof(Entry) + header->PathBytes;
+        if (paths_end > size || (header->PathBytes > 0 && getPaths(header)[header->PathBytes - 1] != '\0')) {
+            return NULL;
+        }
+        const Entry* entries = getEntries(header);
+        for (uint32_t i = 0; i < header->EntryCount; i++) {
+            if (entries[i].PathOffset >= header->PathBytes || entries[i].Offset < paths_end || entries[i].Offset + entries[i].StoredSize > size
+                || (entries[i].Compression == CompressionNone && entries[i].StoredSize != entries[i].Size) || entries[i].Compression > CompressionLZ) {
+                return NULL;
+            }
+        }
+        return header;
+    }
+
+    //entry for a (normalized) path, NULL if the package doesn't have it
+    inline const Entry* find(const Header* header, const std::string& path) {
+        uint64_t path_hash = hash(path.c_str(), path.size());
+        const Entry* entries = getEntries(header);
+        const Entry* found = std::lower_bound(entries, entries + header->EntryCount, path_hash, [](const Entry& entry, uint64_t value) { return entry.PathHash < value; });
+        for (; found < entries + header->EntryCount && found->PathHash == path_hash; found++) { //colliding hashes sit next to each other
+            if (path == getPaths(header) + found->PathOffset) {
+                return found;
+            }
+        }
+        return NULL;
+    }
+
+    /*
+    byte oriented lz77, sequences of:
+        token      literal count in the high 4 bits, match length - MinMatch in the low 4 (15 in either means extra length bytes follow,
+                   each added on, until one is under 255)
+        literals
+        offset     2 bytes little-endian, back from the current output position
+    the last sequence is literals only, and ends the input. matches may overlap their own output (runs)
+    */
+    const size_t MinMatch = 4;
+    const size_t MaxOffset = 65535;
+
+    inline void writeLength(std::vector<unsigned char>& out, size_t length) {
+        while (length >= 255) {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back((unsigned char)length);
+    }
+
+    inline void writeSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t literal_count, size_t match_length, size_t offset) {
+        size_t match_code = match_length >= MinMatch ? match_length - MinMatch : 0;
+        out.push_back((unsigned char)(std::min(literal_count, (size_t)15) << 4 | std::min(match_code, (size_t)15)));
+        if (literal_count >= 15) {
+            writeLength(out, literal_count - 15);
+        }
+        out.insert(out.end(), literals, literals + literal_count);
+        if (match_length >= MinMatch) {
+            out.push_back((unsigned char)(offset & 0xFF));
+            out.push_back((unsigned char)(offset >> 8));
+            if (match_code >= 15) {
+                writeLength(out, match_code - 15);
+            }
+        }
+    }
+
+    inline std::vector<unsigned char> compress(const unsigned char* data, size_t size) {
+        const int HashBits = 16;
+        std::vector<unsigned char> out;
+        out.reserve(size / 2 + 16);
+        std::vector<int64_t> table((size_t)1 << HashBits, -1); //last position each 4 byte prefix was seen at
+        size_t literal_start = 0;
+        size_t i = 0;
+        while (i + MinMatch <= size) {
+            uint32_t prefix;
+            memcpy(&prefix, data + i, sizeof(prefix));
+            uint32_t slot = (prefix * 2654435761u) >> (32 - HashBits);
+            int64_t candidate = table[slot];
+            table[slot] = (int64_t)i;
+            if (candidate < 0 || i - (size_t)candidate > MaxOffset || memcmp(data + candidate, data + i, MinMatch) != 0) {
+                i++;
+                continue;
+            }
+            size_t length = MinMatch;
+            while (i + length < size && data[candidate + length] == data[i + length]) {
+                length++;
+            }
+            writeSequence(out, data + literal_start, i - literal_start, length, i - (size_t)candidate);
+            i += length;
+            literal_start = i;
+        }
+        writeSequence(out, data + literal_start, size - literal_start, 0, 0);
+        return out;
+    }
+
+    //false if data is corrupt or doesn't decode to exactly size bytes
+    inline bool decompress(const unsigned char* data, size_t stored_size, unsigned char* out, size_t size) {
+        const unsigned char* in = data;
+        const unsigned char* in_end = data + stored_size;
+        unsigned char* write = out;
+        unsigned char* out_end = out + size;
+        auto readLength = [&](size_t& length) {
+            unsigned char extra;
+            do {
+                if (in >= in_end) {
+                    return false;
+                }
+                extra = *in++;
+                length += extra;
+            } while (extra == 255);
+            return true;
+        };
+        while (in < in_end) {
+            unsigned char token = *in++;
+            size_t literal_count = token >> 4;
+            if (literal_count == 15 && !readLength(literal_count)) {
+                return false;
+            }
+            if (literal_count > (size_t)(in_end - in) || literal_count > (size_t)(out_end - write)) {
+                return false;
+            }
+            memcpy(write, in, literal_count);
+            in += literal_count;
+            write += literal_count;
+            if (in == in_end) {
+                break; //last sequence
+            }
+            if (in_end - in < 2) {
+                return false;
+            }
+            size_t offset = in[0] | (size_t)in[1] << 8;
+            in += 2;
+            size_t match_length = token & 15;
+            if (match_length == 15 && !readLength(match_length)) {
+                return false;
+            }
+            match_length += MinMatch;
+            if (offset == 0 || offset > (size_t)(write - out) || match_length > (size_t)(out_end - write)) {
+                return false;
+            }
+            const unsigned char* match = write - offset;
+            for (size_t k = 0; k < match_length; k++) { //byte by byte, runs read what they've just written
+                write[k] = match[k];
+            }
+            write += match_length;
+        }
+        return write == out_end;
+    }
+
+    struct BuildStats {
+        size_t Files;
+        size_t Compressed; //files stored compressed
+        uint64_t Bytes; //of the sources
+        uint64_t StoredBytes; //of the payloads
+    };
+
+    //pack files (read from disk, stored under their normalized paths) into one package. files are compressed when that saves at least
+    //an eighth, anything already compressed (jpgs) stays as is and can be used straight out of the mapping
+    inline bool build(std::string package_filename, const std::vector<std::string>& filenames, bool allow_compression = true, BuildStats* stats = NULL) {
+        struct Source {
+            std::string Path;
+            std::vector<unsigned char> Compressed; //empty if stored as is
+            MappedFile File;
+        };
+        std::vector<Source> sources(filenames.size());
+        std::vector<Entry> entries(filenames.size());
+        std::string paths;
+        BuildStats totals = {};
+        for (size_t i = 0; i < filenames.size(); i++) {
+            Source& source = sources[i];
+            source.Path = normalizePath(filenames[i]);
+            if (!source.File.open(filenames[i])) {
+                std::cout << "Failed to read " << filenames[i] << std::endl;
+                return false;
+            }
+            if (allow_compression) {
+                std::vector<unsigned char> compressed = compress(source.File.getData(), source.File.getSize());
+                if (compressed.size() <= source.File.getSize() - source.File.getSize() / 8) {
+                    source.Compressed = std::move(compressed);
+                }
+            }
+            Entry& entry = entries[i];
+            entry = {};
+            entry.PathHash = hash(source.Path.c_str(), source.Path.size());
+            entry.Size = source.File.getSize();
+            entry.StoredSize = source.Compressed.empty() ? entry.Size : source.Compressed.size();
+            entry.Compression = source.Compressed.empty() ? CompressionNone : CompressionLZ;
+            entry.PathOffset = (uint32_t)paths.size();
+            paths += source.Path;
+            paths += '\0';
+            totals.Files++;
+            totals.Compressed += source.Compressed.empty() ? 0 : 1;
+            totals.Bytes += entry.Size;
+            totals.StoredBytes += entry.StoredSize;
+        }
+
+        std::vector<size_t> order(entries.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return entries[a].PathHash != entries[b].PathHash ? entries[a].PathHash < entries[b].PathHash : sources[a].Path < sources[b].Path;
+        });
+        for (size_t i = 1; i < order.size(); i++) {
+            if (sources[order[i]].Path == sources[order[i - 1]].Path) {
+                std::cout << "Duplicate package path " << sources[order[i]].Path << std::endl;
+                return false;
+            }
+        }
+
+        Header header = {};
+        header.Magic = Magic;
+        header.Version = Version;
+        header.EntryCount = (uint32_t)entries.size();
+        header.PathBytes = (uint32_t)paths.size();
+        uint64_t offset = sizeof(Header) + entries.size() * sizeof(Entry) + paths.size();
+        std::vector<Entry> sorted_entries;
+        for (size_t i : order) { //payloads in the same order as the index
+            offset = (offset + BlobAlignment - 1) / BlobAlignment * BlobAlignment;
+            entries[i].Offset = offset;
+            offset += entries[i].StoredSize;
+            sorted_entries.push_back(entries[i]);
+        }
+
+        std::ofstream file(package_filename, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(Header));
+        file.write((const char*)sorted_entries.data(), sorted_entries.size() * sizeof(Entry));
+        file.write(paths.data(), paths.size());
+        uint64_t written = sizeof(Header) + sorted_entries.size() * sizeof(Entry) + paths.size();
+        const char zeros[BlobAlignment] = {};
+        for (size_t i : order) {
+            file.write(zeros, entries[i].Offset - written);
+            const Source& source = sources[i];
+            if (source.Compressed.empty()) {
+                file.write((const char*)source.File.getData(), source.File.getSize());
+            }
+            else {
+                file.write((const char*)source.Compressed.data(), source.Compressed.size());
+            }
+            written = entries[i].Offset + entries[i].StoredSize;
+        }
+        if (stats) {
+            *stats = totals;
+        }
+        return (bool)file;
+    }
+}
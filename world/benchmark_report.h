@@ -0,0 +1,95 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdint>
+
+#include "frame_profiler.h"
+
+namespace BenchmarkReport { //json summary of a headless run, from a profiler whose window covers every frame of the run
+    struct Config {
+        std::string Renderer; //GL_RENDERER
+        int Width;
+        int Height;
+        int CubeCount;
+        bool Instanced;
+        bool GPUAnimation;
+        bool Culling;
+        bool ShaderCache;
+
+        //startup
+        double ShaderMs; //starting and finishing every program
+        int CachedPrograms; //of Programs, loaded from the shader cache
+        int Programs;
+        double FirstFrameMs;
+        uint64_t DedupSavedBytes; //memory shared textures and meshes didn't need
+    };
+
+    inline std::string escape(std::string text) {
+        std::string result;
+        for (int i = 0; i < text.size(); i++) {
+            if (text[i] == '"' || text[i] == '\\') {
+                result += '\\';
+            }
+            if ((unsigned char)text[i] >= 0x20) {
+                result += text[i];
+            }
+        }
+        return result;
+    }
+
+    inline void writeSummary(std::ofstream& file, const FrameProfiler::Summary& summary) {
+        file << "{ \"mean\": " << summary.Mean << ", \"min\": " << summary.Min << ", \"p50\": " << summary.P50 << ", \"p90\": " << summary.P90
+            << ", \"p95\": " << summary.P95 << ", \"p99\": " << summary.P99 << ", \"max\": " << summary.Max << " }";
+    }
+
+    inline bool write(std::string filename, const Config& config, FrameProfiler& profiler) {
+        std::ofstream file(filename, std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+
+        file << "{\n";
+        file << "  \"config\": {\n";
+        file << "    \"renderer\": \"" << escape(config.Renderer) << "\",\n";
+        file << "    \"width\": " << config.Width << ",\n";
+        file << "    \"height\": " << config.Height << ",\n";
+        file << "    \"cubes\": " << config.CubeCount << ",\n";
+        file << "    \"instanced\": " << (config.Instanced ? "true" : "false") << ",\n";
+        file << "    \"gpu_animation\": " << (config.GPUAnimation ? "true" : "false") << ",\n";
+        file << "    \"culling\": " << (config.Culling ? "true" : "false") << ",\n";
+        file << "    \"shader_cache\": " << (config.ShaderCache ? "true" : "false") << "\n";
+        file << "  },\n";
+        file << "  \"startup\": {\n";
+        file << "    \"shader_ms\": " << config.ShaderMs << ",\n";
+        file << "    \"cached_programs\": " << config.CachedPrograms << ",\n";
+        file << "    \"programs\": " << config.Programs << ",\n";
+        file << "    \"first_frame_ms\": " << config.FirstFrameMs << ",\n";
+        file << "    \"dedup_saved_bytes\": " << config.DedupSavedBytes << "\n";
+        file << "  },\n";
+        file << "  \"frames\": " << profiler.getCPUSummary().Samples << ",\n";
+        file << "  \"frame_ms\": ";
+        writeSummary(file, profiler.getCPUSummary());
+        file << ",\n";
+        file << "  \"gpu_frame_ms\": ";
+        writeSummary(file, profiler.getGPUSummary());
+        file << ",\n";
+        file << "  \"gpu_frames\": " << profiler.getGPUSummary().Samples << ",\n"; //with gpu times, of frames
+        file << "  \"gpu_overruns\": " << profiler.getGPUOverruns() << ",\n"; //gpu time over wall clock frame time, should be 0
+        file << "  \"passes\": {\n"; //mean ms per frame
+        for (int pass = 0; pass < FrameProfiler::PassCount; pass++) {
+            file << "    \"" << FrameProfiler::getPassName(pass) << "\": { \"cpu_ms\": " << profiler.getCPUSummary(pass).Mean << ", \"gpu_ms\": " << profiler.getGPUSummary(pass).Mean << " }"
+                << (pass + 1 < FrameProfiler::PassCount ? ",\n" : "\n");
+        }
+        file << "  },\n";
+        file << "  \"counters\": {\n"; //means per frame
+        for (int counter = 0; counter < FrameProfiler::CounterCount; counter++) {
+            file << "    \"" << FrameProfiler::getCounterName(counter) << "\": " << profiler.getCounterSummary((FrameProfiler::Counter)counter).Mean
+                << (counter + 1 < FrameProfiler::CounterCount ? ",\n" : "\n");
+        }
+        file << "  }\n";
+        file << "}\n";
+        return (bool)file;
+    }
+}
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <glm.hpp>
+
+#include "job_system.h"
+
+struct CullStats { //per frame culling counters
+    int Tested; //bounding box tests performed (bvh nodes and objects)
+    int Visible; //objects that passed
+};
+
+class Frustum { //6 planes (left, right, bottom, top, near, far) with normals pointing inwards, extracted from a view-projection matrix
+public:
+    glm::vec4 Planes[6];
+
+    Frustum() {
+        for (int i = 0; i < 6; i++) {
+            Planes[i] = glm::vec4();
+        }
+    }
+
+    Frustum(glm::mat4 view_proj) { //Gribb/Hartmann: each plane is the 4th row of the matrix plus or minus one of the other rows
+        for (int i = 0; i < 3; i++) {
+            Planes[i * 2] = glm::vec4(view_proj[0][3] + view_proj[0][i], view_proj[1][3] + view_proj[1][i], view_proj[2][3] + view_proj[2][i], view_proj[3][3] + view_proj[3][i]);
+            Planes[i * 2 + 1] = glm::vec4(view_proj[0][3] - view_proj[0][i], view_proj[1][3] - view_proj[1][i], view_proj[2][3] - view_proj[2][i], view_proj[3][3] - view_proj[3][i]);
+        }
+        for (int i = 0; i < 6; i++) {
+            glm::vec3 normal = glm::vec3(Planes[i].x, Planes[i].y, Planes[i].z);
+            Planes[i] = Planes[i] / sqrtf(glm::dot(normal, normal));
+        }
+    }
+
+    //test an axis aligned box against the planes whose bit is set in plane_mask.
+    //returns false if the box is entirely outside, otherwise clears the bits of planes the box is entirely inside of
+    bool testAABB(glm::vec3 min, glm::vec3 max, int& plane_mask) const {
+        for (int i = 0; i < 6; i++) {
+            if (!(plane_mask & (1 << i))) {
+                continue;
+            }
+            const glm::vec4& plane = Planes[i];
+            glm::vec3 positive = glm::vec3(plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y, plane.z >= 0.0f ? max.z : min.z); //corner furthest along the normal
+            if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w < 0.0f) {
+                return false;
+            }
+            glm::vec3 negative = glm::vec3(plane.x >= 0.0f ? min.x : max.x, plane.y >= 0.0f ? min.y : max.y, plane.z >= 0.0f ? min.z : max.z);
+            if (plane.x * negative.x + plane.y * negative.y + plane.z * negative.z + plane.w >= 0.0f) {
+                plane_mask &= ~(1 << i);
+            }
+        }
+        return true;
+    }
+};
+
+class BVH { //bounding volume hierarchy over object bounding boxes, supports incremental refitting when objects move
+    struct Node {
+        glm::vec3 Min;
+        glm::vec3 Max;
+        int Parent;
+        int Left; //children, -1 for leaves
+        int Right;
+        int First; //range in ObjectIndices covered by this subtree
+        int Count;
+    };
+
+    std::vector<Node> Nodes;
+    std::vector<int> ObjectIndices; //objects ordered so every leaf covers a contiguous range
+    std::vector<int> ObjectLeaves; //leaf node holding each object
+    std::vector<glm::vec3> ObjectMins;
+    std::vector<glm::vec3> ObjectMaxs;
+    std::vector<int> DirtyLeaves;
+    std::vector<int> Stack;
+
+    struct SubtreeResult { //per job output of a parallel cull, merged in order afterwards
+        std::vector<int> Visible;
+        std::vector<int> Stack;
+        int Tested;
+    };
+    std::vector<std::pair<int, int>> Subtrees; //node index and plane mask
+    std::vector<std::pair<int, int>> NextSubtrees;
+    std::vector<SubtreeResult> SubtreeResults;
+
+public:
+    static const int MaxLeafSize = 4;
+    static const int MinParallelObjects = 32768; //below this culling finishes faster than it can be shared out
+
+    void build(const std::vector<glm::vec3>& mins, const std::vector<glm::vec3>& maxs) { //top down build, splitting at the centroid median of the longest axis
+        ObjectMins = mins;
+        ObjectMaxs = maxs;
+        int count = (int)mins.size();
+        ObjectIndices.resize(count);
+        ObjectLeaves.assign(count, -1);
+        for (int i = 0; i < count; i++) {
+            ObjectIndices[i] = i;
+        }
+        Nodes.clear();
+        DirtyLeaves.clear();
+        if (count == 0) {
+            return;
+        }
+        Nodes.reserve(2 * (count / MaxLeafSize + 1));
+        buildNode(-1, 0, count);
+    }
+
+    int getObjectCount() {
+        return (int)ObjectMins.size();
+    }
+
+    int getNodeCount() {
+        return (int)Nodes.size();
+    }
+
+    void updateObject(int object, glm::vec3 min, glm::vec3 max) { //object moved, bounds are fixed up on the next refit()
+        ObjectMins[object] = min;
+        ObjectMaxs[object] = max;
+        DirtyLeaves.push_back(ObjectLeaves[object]);
+    }
+
+    void refit() { //recompute the bounds of dirty leaves and walk up until a parent's bounds stop changing
+        for (int d = 0; d < DirtyLeaves.size(); d++) {
+            int node_index = DirtyLeaves[d];
+            while (node_index >= 0) {
+                Node& node = Nodes[node_index];
+                glm::vec3 min = glm::vec3(INFINITY);
+                glm::vec3 max = glm::vec3(-INFINITY);
+                if (node.Left < 0) {
+                    for (int i = node.First; i < node.First + node.Count; i++) {
+                        min = glm::min(min, ObjectMins[ObjectIndices[i]]);
+                        max = glm::max(max, ObjectMaxs[ObjectIndices[i]]);
+                    }
+                }
+                else {
+                    min = glm::min(Nodes[node.Left].Min, Nodes[node.Right].Min);
+                    max = glm::max(Nodes[node.Left].Max, Nodes[node.Right].Max);
+                }
+                if (min == node.Min && max == node.Max) {
+                    break; //ancestors already contain these bounds
+                }
+                node.Min = min;
+                node.Max = max;
+                node_index = node.Parent;
+            }
+        }
+        DirtyLeaves.clear();
+    }
+
+    //append every object at least partly inside the frustum to visible. whole subtrees are accepted or rejected with one test
+    void cull(const Frustum& frustum, std::vector<int>& visible, CullStats& stats) {
+        visible.clear();
+        stats.Tested = 0;
+        stats.Visible = 0;
+        if (Nodes.empty()) {
+            return;
+        }
+
+        cullSubtree(frustum, 0, 0x3F, visible, stats.Tested, Stack);
+        stats.Visible = (int)visible.size();
+    }
+
+    //same objects as cull() above (in a different order), with the tree split into subtrees culled as parallel jobs
+    void cull(const Frustum& frustum, std::vector<int>& visible, CullStats& stats, JobSystem& jobs) {
+        if (jobs.getThreadCount() == 1 || getObjectCount() < MinParallelObjects) {
+            cull(frustum, visible, stats);
+            return;
+        }
+        visible.clear();
+        stats.Tested = 0;
+        stats.Visible = 0;
+
+        //test the top of the tree a level at a time until there are enough subtrees to share out. leaves and subtrees already known
+        //to be entirely inside aren't expanded further
+        size_t target = (size_t)jobs.getThreadCount() * JobSystem::RangesPerThread;
+        Subtrees.assign(1, std::make_pair(0, 0x3F));
+        bool expanded = true;
+        while (expanded && Subtrees.size() < target) {
+            expanded = false;
+            NextSubtrees.clear();
+            for (int i = 0; i < Subtrees.size(); i++) {
+                const Node& node = Nodes[Subtrees[i].first];
+                int plane_mask = Subtrees[i].second;
+                if (node.Left < 0 || plane_mask == 0) {
+                    NextSubtrees.push_back(Subtrees[i]);
+                    continue;
+                }
+                stats.Tested++;
+                if (!frustum.testAABB(node.Min, node.Max, plane_mask)) {
+                    continue;
+                }
+                NextSubtrees.push_back(std::make_pair(node.Left, plane_mask));
+                NextSubtrees.push_back(std::make_pair(node.Right, plane_mask));
+                expanded = true;
+            }
+            Subtrees.swap(NextSubtrees);
+        }
+
+        if (SubtreeResults.size() < Subtrees.size()) {
+            SubtreeResults.resize(Subtrees.size());
+        }
+        jobs.parallelFor(Subtrees.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                SubtreeResult& result = SubtreeResults[i];
+                result.Visible.clear();
+                result.Tested = 0;
+                cullSubtree(frustum, Subtrees[i].first, Subtrees[i].second, result.Visible, result.Tested, result.Stack);
+            }
+        });
+
+        for (int i = 0; i < Subtrees.size(); i++) {
+            visible.insert(visible.end(), SubtreeResults[i].Visible.begin(), SubtreeResults[i].Visible.end());
+            stats.Tested += SubtreeResults[i].Tested;
+        }
+        stats.Visible = (int)visible.size();
+    }
+
+private:
+    //depth first from one node, appending visible objects and counting box tests. stack is scratch space
+    void cullSubtree(const Frustum& frustum, int root, int root_mask, std::vector<int>& visible, int& tested, std::vector<int>& stack) {
+        stack.clear();
+        stack.push_back(root); //node index and plane mask are pushed as pairs
+        stack.push_back(root_mask);
+        while (!stack.empty()) {
+            int plane_mask = stack.back();
+            stack.pop_back();
+            int node_index = stack.back();
+            stack.pop_back();
+            Node& node = Nodes[node_index];
+
+            tested++;
+            if (!frustum.testAABB(node.Min, node.Max, plane_mask)) {
+                continue;
+            }
+            if (plane_mask == 0) { //entirely inside, take the whole subtree without testing
+                appendSubtree(node_index, visible);
+                continue;
+            }
+            if (node.Left < 0) {
+                for (int i = node.First; i < node.First + node.Count; i++) {
+                    int object = ObjectIndices[i];
+                    int object_mask = plane_mask;
+                    tested++;
+                    if (frustum.testAABB(ObjectMins[object], ObjectMaxs[object], object_mask)) {
+                        visible.push_back(object);
+                    }
+                }
+                continue;
+            }
+            stack.push_back(node.Left);
+            stack.push_back(plane_mask);
+            stack.push_back(node.Right);
+            stack.push_back(plane_mask);
+        }
+    }
+
+    int buildNode(int parent, int first, int count) {
+        int node_index = (int)Nodes.size();
+        Nodes.push_back(Node());
+
+        glm::vec3 min = glm::vec3(INFINITY);
+        glm::vec3 max = glm::vec3(-INFINITY);
+        glm::vec3 centroid_min = glm::vec3(INFINITY);
+        glm::vec3 centroid_max = glm::vec3(-INFINITY);
+        for (int i = first; i < first + count; i++) {
+            int object = ObjectIndices[i];
+            min = glm::min(min, ObjectMins[object]);
+            max = glm::max(max, ObjectMaxs[object]);
+            glm::vec3 centroid = (ObjectMins[object] + ObjectMaxs[object]) * 0.5f;
+            centroid_min = glm::min(centroid_min, centroid);
+            centroid_max = glm::max(centroid_max, centroid);
+        }
+
+        Node node;
+        node.Min = min;
+        node.Max = max;
+        node.Parent = parent;
+        node.Left = -1;
+        node.Right = -1;
+        node.First = first;
+        node.Count = count;
+
+        if (count > MaxLeafSize) {
+            glm::vec3 extent = centroid_max - centroid_min;
+            int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+            int half = count / 2;
+            std::nth_element(ObjectIndices.begin() + first, ObjectIndices.begin() + first + half, ObjectIndices.begin() + first + count, [&](int a, int b) {
+                return ObjectMins[a][axis] + ObjectMaxs[a][axis] < ObjectMins[b][axis] + ObjectMaxs[b][axis];
+            });
+            Nodes[node_index] = node;
+            int left = buildNode(node_index, first, half);
+            int right = buildNode(node_index, first + half, count - half);
+            Nodes[node_index].Left = left;
+            Nodes[node_index].Right = right;
+        }
+        else {
+            Nodes[node_index] = node;
+            for (int i = first; i < first + count; i++) {
+                ObjectLeaves[ObjectIndices[i]] = node_index;
+            }
+        }
+        return node_index;
+    }
+
+    void appendSubtree(int node_index, std::vector<int>& visible) {
+        const Node& node = Nodes[node_index];
+        visible.insert(visible.end(), ObjectIndices.begin() + node.First, ObjectIndices.begin() + node.First + node.Count);
+    }
+};
@@ -9,6 +9,13 @@ https://www.youtube.com/watch?v=QM4WW8hcsPU&list=PLvv0ScY6vfd-p1gSnbQhY7vMe2rng0
 #include <fstream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
 
 #include <glad/glad.h>
 
@@ -21,6 +28,28 @@ https://www.youtube.com/watch?v=QM4WW8hcsPU&list=PLvv0ScY6vfd-p1gSnbQhY7vMe2rng0
 #include <gtc/matrix_transform.hpp>
 #include <gtc/type_ptr.hpp>
 
+#include "asset_package.h"
+#include "virtual_file_system.h"
+#include "mesh_file.h"
+#include "mesh_csv.h"
+#include "mesh_optimizer.h"
+#include "vertex_format.h"
+#include "mesh_simplifier.h"
+#include "shader_program.h"
+#include "transform_batch.h"
+#include "job_system.h"
+#include "culling.h"
+#include "occlusion_culling.h"
+#include "voxel_world.h"
+#include "texture_loader.h"
+#include "texture_array.h"
+#include "headless_context.h"
+#include "frame_profiler.h"
+#include "benchmark_report.h"
+#include "triple_buffer.h"
+#include "stream_buffer.h"
+#include "render_queue.h"
+
 namespace Utils {
     float clamp(float val, float low, float high) {
         if (val < low) {
@@ -36,10 +65,9 @@ namespace Utils {
         return static_cast <float> (rand()) / static_cast <float> (RAND_MAX);
     }
 
-    std::string readFile(std::string filename) { //read entire file (https://stackoverflow.com/questions/2912520/read-file-contents-into-a-string-in-c)
-        std::ifstream my_file(filename);
-        std::string my_string((std::istreambuf_iterator<char>(my_file)), (std::istreambuf_iterator<char>()));
-        return my_string;
+    std::string readFile(std::string filename) { //read entire file, from a mounted package or disk
+        VirtualFile file = VirtualFileSystem::getDefault().read(filename);
+        return std::string((const char*)file.getData(), file.getSize());
     }
 
     std::vector<std::string> splitOn(std::string input, std::string delimiter) {
@@ -55,6 +83,14 @@ namespace Utils {
         return chunks;
     }
 
+    bool isOutOfDate(std::string source, std::string target) { //true if target is missing or older than source
+        std::error_code error;
+        if (!std::filesystem::exists(target, error)) {
+            return true;
+        }
+        return std::filesystem::last_write_time(source, error) > std::filesystem::last_write_time(target, error);
+    }
+
     template<typename T>
     void print(T x) {
         std::cout << x << std::endl;
@@ -67,10 +103,97 @@ public:
     int ScreenHeight;
     std::string Name;
 
+    int CubeCount;
+    bool Instanced; //draw all cubes with one instanced draw call, rather than one draw call each
+    bool GPUAnimation; //spin every cube in the vertex shader from instance data uploaded once, no per cube work on the cpu (and so no culling or lod)
+    bool Culling; //skip cubes outside the view frustum
+    bool OcclusionCulling; //also skip cubes and voxel chunks hidden behind the nearest cubes (needs Culling)
+    double SimulationRate; //fixed simulation ticks per second
+    float LODThreshold; //pixels of simplification error allowed on screen before switching to a finer level of detail, 0 for full detail always
+    int VoxelChunks; //chunks along each horizontal side of the voxel terrain, 0 for none
+    bool ShaderCache; //load linked programs from (and save them to) .wshd files next to the shaders, off to measure a cold start
+
+    bool Headless; //render a scripted camera path offscreen for a fixed number of frames, then write a report
+    int FrameCount;
+    std::string ReportFilename;
+    std::string ProfileFilename; //rolling frame statistics are appended here once a second, if set
+    std::string PackageFilename; //asset package mounted over the loose files, if it exists
+
     Program(int screen_width, int screen_height, std::string name) {
         ScreenWidth = screen_width;
         ScreenHeight = screen_height;
         Name = name;
+
+        CubeCount = 10;
+        Instanced = true;
+        GPUAnimation = false;
+        Culling = true;
+        OcclusionCulling = true;
+        SimulationRate = 60.0;
+        LODThreshold = 1.0f;
+        VoxelChunks = 0;
+        ShaderCache = true;
+
+        Headless = false;
+        FrameCount = 600;
+        ReportFilename = "benchmark.json";
+        ProfileFilename = "";
+        PackageFilename = "assets" + AssetPackage::Extension;
+    }
+
+    //world [--cubes <count>] [--per-draw] [--gpu-animation] [--no-cull] [--no-occlusion] [--sim-rate <hz>] [--lod-threshold <pixels>] [--voxels <chunks>] [--no-shader-cache] [--width <pixels>] [--height <pixels>] [--profile <out.jsonl>] [--package <assets.wpak>] [--headless [--frames <count>] [--report <out.json>]]
+    void parseOptions(int argc, char* argv[]) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--cubes" && i + 1 < argc) {
+                CubeCount = std::max(1, atoi(argv[++i]));
+            }
+            else if (arg == "--per-draw") {
+                Instanced = false;
+            }
+            else if (arg == "--gpu-animation") {
+                GPUAnimation = true;
+            }
+            else if (arg == "--no-cull") {
+                Culling = false;
+            }
+            else if (arg == "--no-occlusion") {
+                OcclusionCulling = false;
+            }
+            else if (arg == "--sim-rate" && i + 1 < argc) {
+                SimulationRate = std::max(1.0, atof(argv[++i]));
+            }
+            else if (arg == "--lod-threshold" && i + 1 < argc) {
+                LODThreshold = std::max(0.0f, (float)atof(argv[++i]));
+            }
+            else if (arg == "--voxels" && i + 1 < argc) {
+                VoxelChunks = std::max(0, atoi(argv[++i]));
+            }
+            else if (arg == "--no-shader-cache") {
+                ShaderCache = false;
+            }
+            else if (arg == "--width" && i + 1 < argc) {
+                ScreenWidth = std::max(1, atoi(argv[++i]));
+            }
+            else if (arg == "--height" && i + 1 < argc) {
+                ScreenHeight = std::max(1, atoi(argv[++i]));
+            }
+            else if (arg == "--headless") {
+                Headless = true;
+            }
+            else if (arg == "--frames" && i + 1 < argc) {
+                FrameCount = std::max(1, atoi(argv[++i]));
+            }
+            else if (arg == "--report" && i + 1 < argc) {
+                ReportFilename = argv[++i];
+            }
+            else if (arg == "--package" && i + 1 < argc) {
+                PackageFilename = argv[++i];
+            }
+            else if (arg == "--profile" && i + 1 < argc) {
+                ProfileFilename = argv[++i];
+            }
+        }
     }
 
     float getAspectRatio() {
@@ -79,40 +202,309 @@ public:
 };
 
 class MeshInstance {
+    VirtualFile File; //backing storage for binary meshes, vertex and index data are read straight out of the package (or file) mapping
+    const MeshFile::Header* FileHeader;
+    bool Loaded;
+
 public:
-    std::vector<GLfloat> VertexData;
+    std::vector<GLfloat> VertexData; //only filled for csv meshes
     std::vector<GLint> IndexData;
 
-    MeshInstance(std::string filename) {
+    std::vector<MeshSimplifier::Level> LODs; //finest first, empty until buildLODs()
+    std::vector<unsigned char> LODIndexData; //every level's indices back to back, in getIndexType()
+
+    glm::vec3 BoundsMin; //local space bounding box
+    glm::vec3 BoundsMax;
+
+    MeshInstance(std::string filename) { //load either a binary (.mesh) or csv mesh, check isLoaded() for errors (already reported)
+        FileHeader = NULL;
+        Loaded = false;
         VertexData = {};
         IndexData = {};
 
-        std::string file_string = Utils::readFile(filename);
-        std::vector<std::string> split_strings = Utils::splitOn(file_string, "\n\n");
+        if (MeshFile::hasExtension(filename)) {
+            loadBinary(filename);
+        }
+        else {
+            loadCSV(filename);
+        }
+        computeBounds();
+    }
 
-        std::vector<std::string> vertex_lines = Utils::splitOn(split_strings[0], "\n");
-        std::vector<std::string> index_lines = Utils::splitOn(split_strings[1], "\n");
+    bool isLoaded() {
+        return Loaded;
+    }
 
-        for (int i = 0; i < vertex_lines.size(); i++) {
-            std::vector<std::string> vertex_strings = Utils::splitOn(vertex_lines[i], ",");
-            for (int j = 0; j < vertex_strings.size(); j++) {
-                VertexData.push_back(std::stof(vertex_strings[j]));
-            }
+    bool save(std::string filename) { //write mesh out in the binary format
+        std::vector<MeshFile::AttributeDesc> layout = getLayout();
+        return MeshFile::write(filename, layout, getVertexStride(), getVertexData(), getVertexCount(), getIndexType(), getIndexData(), getIndexCount(), getDequantization());
+    }
+
+    const void* getVertexData() {
+        if (FileHeader) {
+            return File.getData() + FileHeader->VertexOffset;
         }
-        for (int i = 0; i < index_lines.size(); i++) {
-            std::vector<std::string> index_strings = Utils::splitOn(index_lines[i], ",");
-            for (int j = 0; j < index_strings.size(); j++) {
-                IndexData.push_back(std::stoi(index_strings[j]));
-            }
+        return VertexData.data();
+    }
+
+    const void* getIndexData() {
+        if (FileHeader) {
+            return File.getData() + FileHeader->IndexOffset;
         }
+        return IndexData.data();
     }
 
     GLsizeiptr getVertexDataSize() {
-        return sizeof(VertexData[0]) * VertexData.size();
+        return (GLsizeiptr)getVertexCount() * getVertexStride();
     }
 
     GLsizeiptr getIndexDataSize() {
-        return sizeof(IndexData[0]) * IndexData.size();
+        return (GLsizeiptr)getIndexCount() * MeshFile::getIndexSize(getIndexType());
+    }
+
+    GLsizei getVertexCount() {
+        if (FileHeader) {
+            return (GLsizei)FileHeader->VertexCount;
+        }
+        return (GLsizei)(VertexData.size() / MeshCSV::ValuesPerVertex);
+    }
+
+    GLsizei getIndexCount() {
+        if (FileHeader) {
+            return (GLsizei)FileHeader->IndexCount;
+        }
+        return (GLsizei)IndexData.size();
+    }
+
+    GLenum getIndexType() {
+        if (FileHeader) {
+            return FileHeader->IndexType;
+        }
+        return GL_UNSIGNED_INT;
+    }
+
+    GLsizei getVertexStride() {
+        if (FileHeader) {
+            return FileHeader->VertexStride;
+        }
+        return 5 * sizeof(GLfloat);
+    }
+
+    std::vector<MeshFile::AttributeDesc> getLayout() {
+        if (FileHeader) {
+            const MeshFile::AttributeDesc* attributes = MeshFile::getAttributes(FileHeader);
+            return std::vector<MeshFile::AttributeDesc>(attributes, attributes + FileHeader->AttributeCount);
+        }
+        return MeshFile::getCSVLayout();
+    }
+
+    MeshFile::Dequantization getDequantization() { //undoes quantized positions and tex coords (identity if they're floats)
+        if (FileHeader) {
+            return FileHeader->Dequantize;
+        }
+        return MeshFile::getIdentityDequantization();
+    }
+
+    //decoded, object space positions
+    std::vector<glm::vec3> getPositions() {
+        std::vector<glm::vec3> positions;
+        std::vector<MeshFile::AttributeDesc> layout = getLayout();
+        const MeshFile::AttributeDesc* position_attribute = VertexFormat::findAttribute(layout, MeshFile::SemanticPosition);
+        if (!position_attribute) {
+            return positions;
+        }
+        MeshFile::Dequantization dequantize = getDequantization();
+        const unsigned char* vertex = (const unsigned char*)getVertexData();
+        positions.resize(getVertexCount());
+        for (GLsizei i = 0; i < getVertexCount(); i++, vertex += getVertexStride()) {
+            float stored[4] = {};
+            VertexFormat::decodeAttribute(*position_attribute, vertex, stored);
+            positions[i] = glm::vec3(dequantize.PositionBias[0] + dequantize.PositionScale[0] * stored[0],
+                dequantize.PositionBias[1] + dequantize.PositionScale[1] * stored[1], dequantize.PositionBias[2] + dequantize.PositionScale[2] * stored[2]);
+        }
+        return positions;
+    }
+
+    //indices widened to 32 bits, whatever the stored index type
+    std::vector<uint32_t> getIndices() {
+        std::vector<uint32_t> indices(getIndexCount());
+        for (GLsizei i = 0; i < getIndexCount(); i++) {
+            indices[i] = getIndexType() == GL_UNSIGNED_SHORT ? ((const uint16_t*)getIndexData())[i] : ((const uint32_t*)getIndexData())[i];
+        }
+        return indices;
+    }
+
+    //simplify into a chain of levels, each about half the triangles of the one before, until a level would deviate from the full mesh by
+    //more than max_error (a fraction of the bounding radius) or stops getting smaller. level 0 is the mesh as it is
+    void buildLODs(int max_levels = 8, float max_error = 0.05f) {
+        std::vector<glm::vec3> positions = getPositions();
+        std::vector<uint32_t> indices = getIndices();
+
+        LODs.clear();
+        std::vector<uint32_t> chain = indices;
+        LODs.push_back({ 0, indices.size(), 0.0f });
+        size_t previous_count = indices.size();
+        while (LODs.size() < max_levels && !positions.empty()) {
+            float error = 0.0f;
+            std::vector<uint32_t> level = MeshSimplifier::simplify(positions, indices, previous_count / 2, max_error * getBoundingRadius(), &error); //from the full mesh, so errors don't compound
+            if (level.empty() || level.size() > previous_count * 9 / 10) {
+                break;
+            }
+            MeshOptimizer::optimizeVertexCache(level, positions.size());
+            LODs.push_back({ chain.size(), level.size(), std::max(error, LODs.back().Error) });
+            chain.insert(chain.end(), level.begin(), level.end());
+            previous_count = level.size();
+        }
+        LODIndexData = MeshOptimizer::packIndices(chain, getIndexType());
+    }
+
+    float getBoundingRadius() { //radius of a sphere around the local origin containing the mesh, holds under any rotation about that origin
+        return glm::length(glm::max(glm::abs(BoundsMin), glm::abs(BoundsMax)));
+    }
+
+private:
+    void computeBounds() {
+        BoundsMin = glm::vec3(0.0f);
+        BoundsMax = glm::vec3(0.0f);
+        std::vector<glm::vec3> positions = getPositions();
+        if (positions.empty()) {
+            return;
+        }
+        BoundsMin = glm::vec3(INFINITY);
+        BoundsMax = glm::vec3(-INFINITY);
+        for (size_t i = 0; i < positions.size(); i++) {
+            BoundsMin = glm::min(BoundsMin, positions[i]);
+            BoundsMax = glm::max(BoundsMax, positions[i]);
+        }
+    }
+
+    void loadBinary(std::string filename) {
+        File = VirtualFileSystem::getDefault().read(filename);
+        if (!File.isOpen()) {
+            std::cout << "Failed to open mesh " << filename << std::endl;
+            return;
+        }
+        FileHeader = MeshFile::validate(File.getData(), File.getSize());
+        if (!FileHeader) {
+            std::cout << "Invalid mesh file " << filename << std::endl;
+            File.close();
+            return;
+        }
+        Loaded = true;
+    }
+
+    void loadCSV(std::string filename) {
+        VirtualFile csv_file = VirtualFileSystem::getDefault().read(filename);
+        if (!csv_file.isOpen() || !MeshCSV::parse((const char*)csv_file.getData(), csv_file.getSize(), VertexData, IndexData)) {
+            std::cout << "Failed to parse mesh " << filename << std::endl;
+            VertexData.clear();
+            IndexData.clear();
+            return;
+        }
+        for (GLint index : IndexData) { //everything downstream (optimizer, simplifier, gpu) indexes per vertex arrays with these
+            if (index < 0 || index >= getVertexCount()) {
+                std::cout << "Mesh " << filename << " has index " << index << " out of range (" << getVertexCount() << " vertices)" << std::endl;
+                VertexData.clear();
+                IndexData.clear();
+                return;
+            }
+        }
+        Loaded = true;
+    }
+};
+
+//a mesh on the gpu: its vertices, every lod's indices and a vertex array with the mesh's own attributes (at their semantic's location,
+//which every program binds). users add their per-instance attributes to the vertex array, or point their own at the buffers
+class MeshResource {
+public:
+    MeshInstance Mesh;
+    GLuint VertexArray;
+    GLuint VertexBuffer;
+    GLuint IndexBuffer;
+
+    MeshResource(std::string filename) : Mesh(filename) {
+        Mesh.buildLODs(); //every level's indices share the one element buffer, drawn with an offset
+        glGenVertexArrays(1, &VertexArray);
+        glBindVertexArray(VertexArray);
+        glGenBuffers(1, &VertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, Mesh.getVertexDataSize(), Mesh.getVertexData(), GL_STATIC_DRAW);
+        glGenBuffers(1, &IndexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, Mesh.LODIndexData.size(), Mesh.LODIndexData.data(), GL_STATIC_DRAW);
+        setAttributes();
+    }
+
+    ~MeshResource() {
+        glDeleteVertexArrays(1, &VertexArray);
+        glDeleteBuffers(1, &VertexBuffer);
+        glDeleteBuffers(1, &IndexBuffer);
+    }
+
+    MeshResource(const MeshResource&) = delete;
+    MeshResource& operator=(const MeshResource&) = delete;
+
+    //point the bound vertex array's mesh attributes at VertexBuffer (which must be bound to GL_ARRAY_BUFFER)
+    void setAttributes() {
+        for (const MeshFile::AttributeDesc& attribute : Mesh.getLayout()) {
+            glVertexAttribPointer(attribute.Semantic, attribute.Components, attribute.Type, attribute.Normalized, Mesh.getVertexStride(), (void*)(uintptr_t)attribute.Offset);
+            glEnableVertexAttribArray(attribute.Semantic);
+        }
+    }
+
+    uint64_t getBytes() { //gpu memory
+        return (uint64_t)Mesh.getVertexDataSize() + Mesh.LODIndexData.size();
+    }
+};
+
+//content addressed meshes: every load of the same file contents (whatever it's called) shares one MeshResource while any handle to it
+//lives. textures and programs are shared the same way by TextureArrayManager and ShaderProgram::acquire(), report() sums all three up
+class ResourceManager {
+public:
+    struct MeshStats {
+        int Requests; //loadMesh() calls
+        int Unique; //meshes those created, the rest were shared
+        uint64_t SavedBytes; //gpu memory sharing saved
+    };
+
+private:
+    std::unordered_map<uint64_t, std::weak_ptr<MeshResource>> Meshes; //by contents hash
+    MeshStats Stats = {};
+
+public:
+    std::shared_ptr<MeshResource> loadMesh(std::string filename) {
+        VirtualFile file = VirtualFileSystem::getDefault().read(filename);
+        uint64_t content_hash = ShaderCache::hashString(filename); //unreadable files only share with themselves, MeshInstance reports the error
+        if (file.isOpen()) {
+            content_hash = ShaderCache::hash(file.getData(), file.getSize());
+        }
+        file.close();
+        Stats.Requests++;
+        auto found = Meshes.find(content_hash);
+        if (found != Meshes.end()) {
+            std::shared_ptr<MeshResource> shared = found->second.lock();
+            if (shared) {
+                Stats.SavedBytes += shared->getBytes();
+                return shared;
+            }
+        }
+        std::shared_ptr<MeshResource> mesh = std::make_shared<MeshResource>(filename);
+        Meshes[content_hash] = mesh;
+        Stats.Unique++;
+        return mesh;
+    }
+
+    MeshStats getMeshStats() {
+        return Stats;
+    }
+
+    //bytes sharing saved so far (program sizes are up to the driver, so they only count)
+    uint64_t report(TextureArrayManager& textures) {
+        TextureArrayManager::Stats texture_stats = textures.getStats();
+        ShaderProgram::SharingStats program_stats = ShaderProgram::getSharingStats();
+        std::cout << "dedup: textures " << texture_stats.Unique << " unique of " << texture_stats.Requests << " (" << texture_stats.SavedBytes / 1024 << " KB saved), meshes "
+            << Stats.Unique << " unique of " << Stats.Requests << " (" << Stats.SavedBytes / 1024 << " KB saved), programs " << program_stats.Unique << " unique of " << program_stats.Requests << std::endl;
+        return texture_stats.SavedBytes + Stats.SavedBytes;
     }
 };
 
@@ -148,6 +540,8 @@ public:
     float Far;
     float Aspect;
 
+    FPSCamera() : FPSCamera(glm::radians(45.0f), 1.0f, 0.1f, 100.0f) {}
+
     FPSCamera(float fov, float aspect, float near, float far) {
         Trans = Transform();
 
@@ -172,6 +566,13 @@ public:
         return Trans.Translation;
     }
 
+    //place the camera on a circle of radius about centre, height above it, looking at centre. angle 0 is on the +z side
+    void setOrbit(glm::vec3 centre, float radius, float height, float angle) {
+        glm::vec3 position = centre + glm::vec3(sinf(angle) * radius, height, cosf(angle) * radius);
+        Trans.Translation = -position; //view matrix moves the world, not the camera
+        setOrientation(glm::vec2(-angle, atan2f(height, radius)));
+    }
+
     void relativeMove(glm::vec3 move) {
         //move rotated about y-axis based on Trans.Rotation.y
         glm::vec3 rotated_move = glm::vec3(glm::rotate(glm::mat4(1.0f), -Trans.Rotation.y, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(-move, 1.0f));
@@ -185,339 +586,1728 @@ public:
     glm::mat4 getProjectionMatrix() {
         return glm::perspective(Fov, Aspect, Near, Far);
     }
+
+    static FPSCamera interpolate(const FPSCamera& a, const FPSCamera& b, float alpha) { //blend position, orientation and fov, turning the short way round
+        FPSCamera result = b;
+        result.Trans.Translation = glm::mix(a.Trans.Translation, b.Trans.Translation, alpha);
+        float yaw_change = fmod(b.Trans.Rotation.y - a.Trans.Rotation.y + 3.0f * (float)M_PI, 2.0f * (float)M_PI) - (float)M_PI;
+        result.Trans.Rotation.y = a.Trans.Rotation.y + yaw_change * alpha;
+        result.Trans.Rotation.x = a.Trans.Rotation.x + (b.Trans.Rotation.x - a.Trans.Rotation.x) * alpha;
+        result.Fov = a.Fov + (b.Fov - a.Fov) * alpha;
+        return result;
+    }
 };
 
-int main(int argc, char* argv[]) {
+struct WorldState { //everything the simulation owns that rendering needs
+    FPSCamera Camera;
+    float MixVal; //texture blend
+    float Time; //simulated seconds, drives the cube rotation
+
+    static WorldState interpolate(const WorldState& a, const WorldState& b, float alpha) {
+        WorldState result = b;
+        result.Camera = FPSCamera::interpolate(a.Camera, b.Camera, alpha);
+        result.MixVal = a.MixVal + (b.MixVal - a.MixVal) * alpha;
+        result.Time = a.Time + (b.Time - a.Time) * alpha;
+        return result;
+    }
+};
 
-    Program main_program = Program(1280, 720, "World Engine");
+struct InputState { //gathered on the main thread (SDL events can only be pumped there). motion is cumulative so no input is lost if the simulation skips a copy
+    int64_t MouseX; //total relative mouse motion
+    int64_t MouseY;
+    int64_t Wheel;
+    int ResetCount; //number of camera reset presses
+    glm::vec3 Move; //held movement keys, -1 to 1 along each camera axis
+    bool Fast;
+    float MixDirection; //held texture mix keys, -1 to 1
+};
 
-    /******************************************************
-    * setup SDL and OpenGL
-    ******************************************************/
+class Simulation { //advances the world at a fixed rate on its own thread, publishing the last two states for the render thread to interpolate between
+    struct Snapshot {
+        WorldState Previous;
+        WorldState Current;
+        Uint64 TickTime; //performance counter time Current was due, rendering shows Previous at this time and reaches Current one tick later
+    };
 
-    if (SDL_Init(SDL_INIT_VIDEO) < 0){
-        std::cout << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
-        SDL_Quit();
-        return -1;
+    WorldState Initial;
+    WorldState State;
+    InputState LastInput; //input as of the previous tick
+    double TickRate; //ticks per second
+    uint64_t Tick;
+
+    TripleBuffer<InputState> Input; //main thread -> simulation
+    TripleBuffer<Snapshot> Snapshots; //simulation -> render thread
+    Snapshot Latest; //render thread copy, the last two states stay available even if nothing new was published
+
+    std::thread Thread;
+    std::atomic<bool> Stopping;
+
+public:
+    static constexpr float MoveSpeed = 5.0f; //units per second
+    static constexpr float FastMult = 2.0f;
+    static constexpr float LookSensitivity = 0.0033f; //radians per pixel
+    static constexpr float ZoomSensitivity = 0.033f; //radians per wheel notch
+    static constexpr float MixSpeed = 0.3f; //per second
+    static const int MaxCatchUpTicks = 8; //after a long stall, skip ahead rather than spiral trying to catch up
+
+    Simulation(WorldState initial, double tick_rate = 60.0) {
+        Initial = initial;
+        State = initial;
+        LastInput = InputState();
+        TickRate = tick_rate;
+        Tick = 0;
+        Latest.Previous = initial;
+        Latest.Current = initial;
+        Latest.TickTime = SDL_GetPerformanceCounter();
+        Input.getBack() = InputState();
+        Input.publish();
+        Stopping = false;
     }
 
-    //specify OpenGL version and profile
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-
-    SDL_Window* window = SDL_CreateWindow(
-        main_program.Name.c_str(), 
-        SDL_WINDOWPOS_UNDEFINED, 
-        SDL_WINDOWPOS_UNDEFINED, 
-        main_program.ScreenWidth, 
-        main_program.ScreenHeight, 
-        SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL);
-    if (window == NULL){
-        std::cout << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
-        SDL_Quit();
-        return -1;
+    ~Simulation() {
+        stop();
     }
 
-    SDL_GLContext context = SDL_GL_CreateContext(window);
-    if (context == NULL) {
-        std::cout << "Context could not be created! SDL_Error: " << SDL_GetError() << std::endl;
-        SDL_Quit();
-        return -1;
+    void start() {
+        Stopping = false;
+        Thread = std::thread(&Simulation::run, this);
     }
 
-    if (gladLoadGLLoader(SDL_GL_GetProcAddress) < 0) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        SDL_Quit();
-        return -1;
+    void stop() {
+        Stopping = true;
+        if (Thread.joinable()) {
+            Thread.join();
+        }
     }
 
-    /******************************************************
-    * setting misc SDL and OpenGL settings
-    ******************************************************/
+    void setInput(const InputState& input) { //main thread
+        Input.getBack() = input;
+        Input.publish();
+    }
 
-    SDL_SetRelativeMouseMode(SDL_TRUE); //keep mouse in screen
+    WorldState getInterpolated() { //render thread, one tick behind the simulation so there's always a state to blend towards
+        if (Snapshots.update()) {
+            Latest = Snapshots.getFront();
+        }
+        double ticks = (double)(SDL_GetPerformanceCounter() - Latest.TickTime) * TickRate / (double)SDL_GetPerformanceFrequency();
+        float alpha = (float)std::min(1.0, std::max(0.0, ticks));
+        return WorldState::interpolate(Latest.Previous, Latest.Current, alpha);
+    }
 
-    glClearColor(0.5f, 0.5f, 0.5f, 1.0f); //set clear color to grey 
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); //set drawing mode
-    glEnable(GL_DEPTH_TEST); //enable z-buffer depth testing
+private:
+    void run() {
+        Uint64 frequency = SDL_GetPerformanceFrequency();
+        Uint64 period = (Uint64)(frequency / TickRate);
+        Uint64 next_tick = SDL_GetPerformanceCounter();
+        while (!Stopping) {
+            Uint64 now = SDL_GetPerformanceCounter();
+            if (now >= next_tick) {
+                if ((now - next_tick) / period >= MaxCatchUpTicks) {
+                    next_tick = now;
+                }
+                Input.update();
+                while (now >= next_tick) {
+                    WorldState previous = State;
+                    step(Input.getFront());
+                    next_tick += period;
+
+                    Snapshot& snapshot = Snapshots.getBack();
+                    snapshot.Previous = previous;
+                    snapshot.Current = State;
+                    snapshot.TickTime = next_tick - period;
+                    Snapshots.publish();
+                }
+            }
+            else {
+                std::this_thread::sleep_for(std::chrono::microseconds((next_tick - now) * 1000000 / frequency));
+            }
+        }
+    }
+
+    void step(const InputState& input) { //one fixed tick, depends only on the previous state and input so runs are repeatable
+        float dt = (float)(1.0 / TickRate);
+        FPSCamera& cam = State.Camera;
+
+        if (input.ResetCount != LastInput.ResetCount) {
+            cam = Initial.Camera;
+        }
+
+        //control texture mix
+        State.MixVal = Utils::clamp(State.MixVal + input.MixDirection * MixSpeed * dt, 0.0f, 1.0f);
+
+        //camera zoom (fov) and rotation
+        cam.Fov -= (input.Wheel - LastInput.Wheel) * ZoomSensitivity;
+        glm::vec2 mouse_move = glm::vec2((float)(input.MouseX - LastInput.MouseX), (float)(input.MouseY - LastInput.MouseY)) * LookSensitivity;
+        cam.setOrientation(cam.getOrientation() + mouse_move);
+
+        //camera movement
+        glm::vec3 move = input.Move;
+        if (move != glm::vec3()) {
+            move = normalize(move) * MoveSpeed * (input.Fast ? FastMult : 1.0f) * dt;
+        }
+        cam.relativeMove(move);
+
+        Tick++;
+        State.Time = (float)(Tick / TickRate);
+        LastInput = input;
+    }
+};
+
+struct CubeLayers { //texture array layers a cube mixes between, laid out as the in_layers instance attribute (2 unsigned shorts)
+    uint16_t Base;
+    uint16_t Overlay;
+};
+
+//example.frag features (bits of a ShaderVariants mask), no bits draws the placeholder grey without sampling
+const uint32_t FeatureTextured = 1; //sample one of the cube's layers
+const uint32_t FeatureBlend = 2; //sample both and mix them by mix_val, with FeatureTextured
+
+struct CubeAnimation { //everything example_animated.vert needs to place a cube at any time, one per instance in a static buffer
+    float Translation[3]; //in_translation
+    float Axis[3]; //in_axis
+    CubeLayers Layers; //in_layers
+};
+
+class AnimatedCubes { //a second vertex array sharing a mesh's buffers, with the instance attributes pointed at a static CubeAnimation buffer for good
+public:
+    GLuint VertexArray;
+    GLuint InstanceBuffer;
+
+    AnimatedCubes(MeshResource& mesh, const std::vector<CubeAnimation>& animations) {
+        glGenVertexArrays(1, &VertexArray);
+        glBindVertexArray(VertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.VertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.IndexBuffer);
+        mesh.setAttributes();
+        glGenBuffers(1, &InstanceBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, InstanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, animations.size() * sizeof(CubeAnimation), animations.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(InstanceTranslationLocation, 3, GL_FLOAT, GL_FALSE, sizeof(CubeAnimation), (void*)offsetof(CubeAnimation, Translation));
+        glVertexAttribPointer(InstanceAxisLocation, 3, GL_FLOAT, GL_FALSE, sizeof(CubeAnimation), (void*)offsetof(CubeAnimation, Axis));
+        glVertexAttribIPointer(InstanceLayersLocation, 2, GL_UNSIGNED_SHORT, sizeof(CubeAnimation), (void*)offsetof(CubeAnimation, Layers));
+        for (GLuint location : { InstanceTranslationLocation, InstanceAxisLocation, InstanceLayersLocation }) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        glBindVertexArray(0);
+    }
+
+    ~AnimatedCubes() {
+        glDeleteVertexArrays(1, &VertexArray);
+        glDeleteBuffers(1, &InstanceBuffer);
+    }
+
+    AnimatedCubes(const AnimatedCubes&) = delete;
+    AnimatedCubes& operator=(const AnimatedCubes&) = delete;
+};
+
+namespace Tools { //command line tools, run instead of the engine (see main)
+    //offline csv -> binary mesh converter. optimizing re-encodes vertices in format, merges duplicate vertices, reorders for the vertex
+    //cache and fetch locality, and stores 16 bit indices when there are few enough vertices
+    int convertMesh(std::string csv_filename, std::string mesh_filename, bool optimize = true, VertexFormat::Format format = VertexFormat::getCompactFormat()) {
+        MeshInstance mesh = MeshInstance(csv_filename);
+        if (!mesh.isLoaded()) {
+            return -1; //nothing written, so a previous good conversion stays in place
+        }
+        if (!optimize) {
+            if (!mesh.save(mesh_filename)) {
+                std::cout << "Failed to write mesh " << mesh_filename << std::endl;
+                return -1;
+            }
+            std::cout << "Converted " << csv_filename << " -> " << mesh_filename << " (" << mesh.getVertexCount() << " vertices, " << mesh.getIndexCount() << " indices)" << std::endl;
+            return 0;
+        }
+
+        //encoded first, so vertices that quantize to the same bytes are merged too
+        VertexFormat::Encoded encoded = VertexFormat::encode(mesh.getLayout(), mesh.getVertexStride(), (const unsigned char*)mesh.getVertexData(), mesh.getVertexCount(), format);
+        std::vector<uint32_t> indices = mesh.getIndices();
+        MeshOptimizer::Stats stats = MeshOptimizer::optimize(encoded.Vertices, encoded.Stride, indices);
+        std::vector<unsigned char> index_data = MeshOptimizer::packIndices(indices, stats.IndexType);
+
+        if (!MeshFile::write(mesh_filename, encoded.Layout, encoded.Stride, encoded.Vertices.data(), stats.VerticesAfter, stats.IndexType, index_data.data(), indices.size(), encoded.Dequantize)) {
+            std::cout << "Failed to write mesh " << mesh_filename << std::endl;
+            return -1;
+        }
+        std::cout << "Converted " << csv_filename << " -> " << mesh_filename << " (" << stats.VerticesBefore << " -> " << stats.VerticesAfter << " vertices, "
+            << mesh.getVertexStride() << " -> " << encoded.Stride << " bytes per vertex, " << mesh.getVertexDataSize() << " -> " << encoded.Vertices.size() << " vertex bytes, "
+            << indices.size() << (stats.IndexType == GL_UNSIGNED_SHORT ? " 16" : " 32") << " bit indices, " << mesh.getIndexDataSize() << " -> " << index_data.size() << " index bytes, "
+            << "ACMR " << stats.ACMRBefore << " -> " << stats.ACMRAfter << ")" << std::endl;
+        return 0;
+    }
+
+    //encode a mesh's vertices in every format, decode them again and check the error stays inside each encoding's bound
+    int checkVertexFormats(std::string csv_filename) {
+        int failures = 0;
+        for (int half = 0; half < 0x10000; half++) { //every half survives a round trip through float (nans just have to stay nans)
+            float value = VertexFormat::halfToFloat((uint16_t)half);
+            uint16_t round_trip = VertexFormat::floatToHalf(value);
+            if (round_trip != half && !(std::isnan(value) && std::isnan(VertexFormat::halfToFloat(round_trip)))) {
+                std::cout << "half 0x" << std::hex << half << " round trips to 0x" << round_trip << std::dec << std::endl;
+                failures++;
+            }
+        }
+
+        MeshInstance mesh = MeshInstance(csv_filename);
+        std::vector<MeshFile::AttributeDesc> layout = mesh.getLayout();
+        const unsigned char* vertices = (const unsigned char*)mesh.getVertexData();
+        const char* format_names[] = { "full", "compact", "unorm" };
+        VertexFormat::Format formats[] = { VertexFormat::getFullFormat(), VertexFormat::getCompactFormat(), { VertexFormat::PositionUnorm16, VertexFormat::TexCoordUnorm16 } };
+        for (int f = 0; f < 3; f++) {
+            VertexFormat::Encoded encoded = VertexFormat::encode(layout, mesh.getVertexStride(), vertices, mesh.getVertexCount(), formats[f]);
+            std::cout << format_names[f] << ": " << encoded.Stride << " bytes per vertex";
+            for (size_t a = 0; a < layout.size(); a++) {
+                bool is_position = layout[a].Semantic == MeshFile::SemanticPosition;
+                const float* scale = is_position ? encoded.Dequantize.PositionScale : encoded.Dequantize.TexCoordScale;
+                const float* bias = is_position ? encoded.Dequantize.PositionBias : encoded.Dequantize.TexCoordBias;
+                float max_error = 0.0f;
+                float bound = 0.0f;
+                for (GLsizei i = 0; i < mesh.getVertexCount(); i++) {
+                    float original[4] = {};
+                    float stored[4] = {};
+                    VertexFormat::decodeAttribute(layout[a], vertices + (size_t)i * mesh.getVertexStride(), original);
+                    VertexFormat::decodeAttribute(encoded.Layout[a], encoded.Vertices.data() + (size_t)i * encoded.Stride, stored);
+                    for (uint32_t c = 0; c < layout[a].Components; c++) {
+                        float decoded = bias[c] + scale[c] * stored[c];
+                        max_error = std::max(max_error, fabsf(decoded - original[c]));
+                        bound = std::max(bound, VertexFormat::getErrorBound(encoded.Layout[a].Type, encoded.Layout[a].Normalized, scale[c], bias[c], bias[c] + scale[c] * (encoded.Layout[a].Normalized ? 1.0f : fabsf(original[c]))));
+                    }
+                }
+                bool passed = max_error <= bound;
+                std::cout << ", " << MeshFile::getSemanticName(layout[a].Semantic) << " max error " << max_error << " (bound " << bound << (passed ? ")" : ", FAILED)");
+                failures += passed ? 0 : 1;
+            }
+            std::cout << std::endl;
+        }
+        return failures == 0 ? 0 : -1;
+    }
+
+    uint64_t checksum(const void* data, GLsizeiptr size) { //touch every byte, standing in for the read glBufferData does
+        const unsigned char* bytes = (const unsigned char*)data;
+        uint64_t sum = 0;
+        for (GLsizeiptr i = 0; i < size; i++) {
+            sum += bytes[i];
+        }
+        return sum;
+    }
+
+    double timeMeshLoad(std::string filename, int iterations, uint64_t& sum) { //average milliseconds per load
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            MeshInstance mesh = MeshInstance(filename);
+            sum += checksum(mesh.getVertexData(), mesh.getVertexDataSize());
+            sum += checksum(mesh.getIndexData(), mesh.getIndexDataSize());
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+
+    int benchmarkMeshLoad(std::string csv_filename, int iterations) { //compare csv and binary load paths for the same mesh
+        std::string mesh_filename = csv_filename + ".bench" + MeshFile::Extension;
+        if (convertMesh(csv_filename, mesh_filename, false) != 0) { //unoptimized, so both paths load identical data
+            return -1;
+        }
+
+        uint64_t csv_sum = 0;
+        uint64_t binary_sum = 0;
+        double csv_ms = timeMeshLoad(csv_filename, iterations, csv_sum);
+        double binary_ms = timeMeshLoad(mesh_filename, iterations, binary_sum);
+        std::filesystem::remove(mesh_filename);
+
+        if (csv_sum != binary_sum) {
+            std::cout << "Mismatch between csv and binary mesh data!" << std::endl;
+            return -1;
+        }
+        std::cout << "csv:    " << csv_ms << " ms/load" << std::endl;
+        std::cout << "binary: " << binary_ms << " ms/load" << std::endl;
+        std::cout << "speedup: " << csv_ms / binary_ms << "x" << std::endl;
+        return 0;
+    }
+
+    //original allocation-heavy csv parser, kept as the reference for the parser benchmark
+    void parseCSVReference(std::string filename, std::vector<GLfloat>& vertex_data, std::vector<GLint>& index_data) {
+        std::string file_string = Utils::readFile(filename);
+        std::vector<std::string> split_strings = Utils::splitOn(file_string, "\n\n");
+
+        std::vector<std::string> vertex_lines = Utils::splitOn(split_strings[0], "\n");
+        std::vector<std::string> index_lines = Utils::splitOn(split_strings[1], "\n");
+
+        for (int i = 0; i < vertex_lines.size(); i++) {
+            std::vector<std::string> vertex_strings = Utils::splitOn(vertex_lines[i], ",");
+            for (int j = 0; j < vertex_strings.size(); j++) {
+                vertex_data.push_back(std::stof(vertex_strings[j]));
+            }
+        }
+        for (int i = 0; i < index_lines.size(); i++) {
+            std::vector<std::string> index_strings = Utils::splitOn(index_lines[i], ",");
+            for (int j = 0; j < index_strings.size(); j++) {
+                index_data.push_back(std::stoi(index_strings[j]));
+            }
+        }
+    }
+
+    int benchmarkCSVParse(std::string csv_filename, int iterations) { //compare the reference and streaming csv parsers, checking they agree
+        VirtualFile csv_file = VirtualFileSystem::getDefault().read(csv_filename);
+        if (!csv_file.isOpen()) {
+            std::cout << "Failed to open " << csv_filename << std::endl;
+            return -1;
+        }
+        double gigabytes = (double)csv_file.getSize() / 1e9;
+
+        std::vector<GLfloat> reference_vertices;
+        std::vector<GLint> reference_indices;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            reference_vertices.clear();
+            reference_indices.clear();
+            parseCSVReference(csv_filename, reference_vertices, reference_indices);
+        }
+        std::chrono::duration<double> reference_time = (std::chrono::high_resolution_clock::now() - start) / iterations;
+
+        std::vector<GLfloat> vertices;
+        std::vector<GLint> indices;
+        JobSystem single_thread = JobSystem(1);
+        JobSystem* job_systems[2] = { &single_thread, &JobSystem::getDefault() };
+        std::chrono::duration<double> streaming_time[2];
+        for (int t = 0; t < 2; t++) {
+            start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                if (!MeshCSV::parse((const char*)csv_file.getData(), csv_file.getSize(), vertices, indices, *job_systems[t])) {
+                    std::cout << "Streaming parser failed on " << csv_filename << std::endl;
+                    return -1;
+                }
+            }
+            streaming_time[t] = (std::chrono::high_resolution_clock::now() - start) / iterations;
+        }
+
+        if (vertices != reference_vertices || indices != reference_indices) {
+            std::cout << "Mismatch between reference and streaming parser output!" << std::endl;
+            return -1;
+        }
+        std::cout << "reference:            " << gigabytes / reference_time.count() << " GB/s" << std::endl;
+        std::cout << "streaming (1 thread): " << gigabytes / streaming_time[0].count() << " GB/s" << std::endl;
+        std::cout << "streaming (" << job_systems[1]->getThreadCount() << " threads): " << gigabytes / streaming_time[1].count() << " GB/s" << std::endl;
+        return 0;
+    }
+
+    int bakeTextures(std::vector<std::string> filenames) { //offline texture cache step, builds (or confirms up to date) the mip chain cache of each image
+        stbi_set_flip_vertically_on_load(true); //must match the engine's setting
+        int result = 0;
+        for (int i = 0; i < filenames.size(); i++) {
+            VirtualFile cache_file;
+            bool rebuilt;
+            const TextureCache::Header* header = TextureCache::open(filenames[i], cache_file, &rebuilt);
+            if (!header) {
+                std::cout << "Failed to bake texture " << filenames[i] << std::endl;
+                result = -1;
+                continue;
+            }
+            std::cout << filenames[i] << " -> " << TextureCache::getCachePath(filenames[i]) << " (" << header->Width << "x" << header->Height << ", " << header->LevelCount << " levels, " << (rebuilt ? "rebuilt" : "up to date") << ")" << std::endl;
+        }
+        return result;
+    }
+
+    //content addressed sharing: an image and a mesh copied under a second name must share the original's layer and MeshResource, and
+    //released ones must be freed (layers reused). other_image_filename has to land in the same size bucket as image_filename
+    int checkResources(std::string image_filename, std::string other_image_filename, std::string mesh_filename) {
+        HeadlessContext context; //MeshResources upload to the gpu
+        if (!context.create(64, 64)) {
+            return -1;
+        }
+        std::vector<std::string> copies;
+        for (std::string filename : { image_filename, mesh_filename }) {
+            std::filesystem::path path = filename;
+            std::filesystem::path copy = path.parent_path() / (path.stem().string() + ".dedup-check" + path.extension().string());
+            std::error_code error;
+            std::filesystem::copy_file(path, copy, error); //never overwrites, a leftover copy is reported
+            if (error) {
+                std::cout << "Failed to copy " << filename << " to " << copy.string() << std::endl;
+                for (std::string written : copies) {
+                    std::filesystem::remove(written, error);
+                }
+                return -1;
+            }
+            copies.push_back(copy.string());
+        }
+
+        int failures = 0;
+        auto check = [&](bool passed, std::string description) {
+            std::cout << (passed ? "ok: " : "FAILED: ") << description << std::endl;
+            failures += passed ? 0 : 1;
+        };
+        {
+            TextureLoader loader;
+            TextureArrayManager textures = TextureArrayManager(loader);
+            TextureArrayManager::Handle original = textures.add(image_filename);
+            TextureArrayManager::Handle copy = textures.add(copies[0]);
+            check(original->Bucket >= 0 && original->Bucket == copy->Bucket && original->Index == copy->Index, copies[0] + " shares the layer of " + image_filename);
+            TextureArrayManager::Stats stats = textures.getStats();
+            check(stats.Requests == 2 && stats.Unique == 1 && stats.SavedBytes == stats.Bytes && stats.SavedBytes > 0,
+                "one layer stored for both, " + std::to_string(stats.SavedBytes / 1024) + " KB saved");
+
+            TextureArrayManager::Layer shared = *original;
+            original.reset();
+            check(textures.add(other_image_filename)->Index != shared.Index, "the layer stays reserved while the copy's handle lives");
+            copy.reset();
+            TextureArrayManager::Handle reused = textures.add(other_image_filename);
+            check(reused->Bucket == shared.Bucket && reused->Index == shared.Index, "the layer is reused once every handle is released");
+        }
+        {
+            ResourceManager resources;
+            std::shared_ptr<MeshResource> original = resources.loadMesh(mesh_filename);
+            std::shared_ptr<MeshResource> copy = resources.loadMesh(copies[1]);
+            check(original->Mesh.isLoaded() && original == copy, copies[1] + " shares the MeshResource of " + mesh_filename);
+            ResourceManager::MeshStats stats = resources.getMeshStats();
+            check(stats.Requests == 2 && stats.Unique == 1 && stats.SavedBytes == original->getBytes() && stats.SavedBytes > 0,
+                "one mesh uploaded for both, " + std::to_string(stats.SavedBytes) + " bytes saved");
+
+            original.reset();
+            copy.reset();
+            resources.loadMesh(mesh_filename);
+            check(resources.getMeshStats().Unique == 2, "the mesh is uploaded again once every handle is released");
+        }
+
+        std::error_code error;
+        for (std::string copy : copies) {
+            std::filesystem::remove(copy, error);
+        }
+        return failures == 0 ? 0 : -1;
+    }
+
+    //offline packing step, e.g. world --pack assets.wpak cube.mesh *.vert *.frag *.jpg *.jpg.wtex (after a run has built the caches)
+    int packAssets(std::string package_filename, std::vector<std::string> filenames, bool compress) {
+        for (std::string filename : filenames) { //loads only check mesh headers, so every index is checked once here
+            if (!MeshFile::hasExtension(filename)) {
+                continue;
+            }
+            MappedFile file;
+            const MeshFile::Header* header = file.open(filename) ? MeshFile::validate(file.getData(), file.getSize()) : NULL;
+            if (!header || !MeshFile::checkIndices(header->IndexType, file.getData() + header->IndexOffset, header->IndexCount, header->VertexCount)) {
+                std::cout << "Not packing " << filename << ", it isn't a valid mesh" << std::endl;
+                return -1;
+            }
+        }
+        AssetPackage::BuildStats stats;
+        if (!AssetPackage::build(package_filename, filenames, compress, &stats)) {
+            std::cout << "Failed to write asset package " << package_filename << std::endl;
+            return -1;
+        }
+        std::cout << "Packed " << stats.Files << " files (" << stats.Compressed << " compressed) into " << package_filename << ", "
+            << stats.Bytes / 1024 << " KB -> " << stats.StoredBytes / 1024 << " KB" << std::endl;
+
+        //read everything back through a file system with just this package mounted, and check it matches the loose files
+        VirtualFileSystem file_system;
+        if (!file_system.mount(package_filename)) {
+            std::cout << "Failed to mount " << package_filename << std::endl;
+            return -1;
+        }
+        for (std::string filename : filenames) {
+            VirtualFile packed = file_system.read(filename);
+            MappedFile loose = MappedFile(filename);
+            if (!file_system.isPacked(filename) || packed.getSize() != loose.getSize() || memcmp(packed.getData(), loose.getData(), loose.getSize()) != 0) {
+                std::cout << "Package mismatch for " << filename << std::endl;
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    double maxError(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b) {
+        double error = 0.0;
+        for (size_t i = 0; i < a.size(); i++) {
+            for (int column = 0; column < 4; column++) {
+                for (int row = 0; row < 4; row++) {
+                    error = std::max(error, (double)fabs(a[i][column][row] - b[i][column][row]));
+                }
+            }
+        }
+        return error;
+    }
+
+    int benchmarkTransforms(int count, int iterations) { //matrices per second for the per-object glm path against every batch kernel, checking they agree
+        TransformBatch::Vec3Array translations, rotations, scales, axes;
+        translations.resize(count);
+        rotations.resize(count);
+        scales.resize(count);
+        axes.resize(count);
+        std::vector<Transform> transforms(count);
+        for (int i = 0; i < count; i++) {
+            transforms[i].Translation = glm::vec3(Utils::getRandFloat() - 0.5f, Utils::getRandFloat() - 0.5f, Utils::getRandFloat() - 0.5f) * 100.0f;
+            transforms[i].Rotation = glm::vec3(Utils::getRandFloat() - 0.5f, Utils::getRandFloat() - 0.5f, Utils::getRandFloat() - 0.5f) * 4.0f * (float)M_PI;
+            transforms[i].Scale = glm::vec3(Utils::getRandFloat(), Utils::getRandFloat(), Utils::getRandFloat()) * 2.0f + glm::vec3(0.1f);
+            translations.set(i, transforms[i].Translation);
+            rotations.set(i, transforms[i].Rotation);
+            scales.set(i, transforms[i].Scale);
+            axes.set(i, glm::vec3(Utils::getRandFloat(), Utils::getRandFloat(), Utils::getRandFloat()) + glm::vec3(0.01f));
+        }
+        float angle = 1.2345f;
+
+        std::vector<glm::mat4> euler_reference(count);
+        std::vector<glm::mat4> axis_angle_reference(count);
+        std::vector<glm::mat4> result(count);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int n = 0; n < iterations; n++) {
+            for (int i = 0; i < count; i++) {
+                euler_reference[i] = transforms[i].getTransformMatrix();
+            }
+        }
+        std::chrono::duration<double> euler_time = (std::chrono::high_resolution_clock::now() - start) / iterations;
+
+        start = std::chrono::high_resolution_clock::now();
+        for (int n = 0; n < iterations; n++) {
+            for (int i = 0; i < count; i++) {
+                axis_angle_reference[i] = glm::rotate(glm::translate(glm::mat4(1.0f), translations.get(i)), angle, axes.get(i));
+            }
+        }
+        std::chrono::duration<double> axis_angle_time = (std::chrono::high_resolution_clock::now() - start) / iterations;
+
+        std::cout << "matrices/s (max abs error)" << std::endl;
+        std::cout << "glm per object:    euler " << count / euler_time.count() << ", axis-angle " << count / axis_angle_time.count() << std::endl;
+
+        JobSystem single_thread = JobSystem(1);
+        for (int level = TransformBatch::LevelScalar; level <= TransformBatch::detectLevel() + 1; level++) {
+            bool threaded = level > TransformBatch::detectLevel(); //final pass is the best level on every thread
+            TransformBatch::Level kernel_level = threaded ? TransformBatch::detectLevel() : (TransformBatch::Level)level;
+            JobSystem& kernel_jobs = threaded ? JobSystem::getDefault() : single_thread;
+
+            start = std::chrono::high_resolution_clock::now();
+            for (int n = 0; n < iterations; n++) {
+                TransformBatch::computeEuler(translations, rotations, scales, result.data(), kernel_level, kernel_jobs);
+            }
+            euler_time = (std::chrono::high_resolution_clock::now() - start) / iterations;
+            double euler_error = maxError(result, euler_reference);
+
+            start = std::chrono::high_resolution_clock::now();
+            for (int n = 0; n < iterations; n++) {
+                TransformBatch::computeAxisAngle(translations, axes, angle, result.data(), kernel_level, kernel_jobs);
+            }
+            axis_angle_time = (std::chrono::high_resolution_clock::now() - start) / iterations;
+            double axis_angle_error = maxError(result, axis_angle_reference);
+
+            std::cout << "batch " << TransformBatch::getLevelName(kernel_level) << " x" << kernel_jobs.getThreadCount() << ":";
+            std::cout << " euler " << count / euler_time.count() << " (" << euler_error << "), axis-angle " << count / axis_angle_time.count() << " (" << axis_angle_error << ")" << std::endl;
+            if (euler_error > 1e-3 || axis_angle_error > 1e-4) {
+                std::cout << "Batch transforms don't match the per object path!" << std::endl;
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    int benchmarkJobs(int count, int iterations) { //job system scaling: csv parsing, model matrices and culling of count objects on 1 to N threads
+        //a csv mesh of count vertices and count triangles, built in memory
+        std::string csv;
+        for (int i = 0; i < count; i++) {
+            csv += std::to_string(Utils::getRandFloat()) + "," + std::to_string(Utils::getRandFloat()) + "," + std::to_string(Utils::getRandFloat()) + ","
+                + std::to_string(Utils::getRandFloat()) + "," + std::to_string(Utils::getRandFloat()) + "\n";
+        }
+        csv += "\n";
+        for (int i = 0; i < count; i++) {
+            csv += std::to_string(rand() % count) + ", " + std::to_string(rand() % count) + ", " + std::to_string(rand() % count) + "\n";
+        }
+
+        //objects spread through a cube, viewed from its centre so culling has a mix of accepted and rejected subtrees
+        float scene_size = 8.0f * cbrt(count / 10.0f);
+        TransformBatch::Vec3Array positions, axes;
+        positions.resize(count);
+        axes.resize(count);
+        std::vector<glm::vec3> mins(count), maxs(count);
+        for (int i = 0; i < count; i++) {
+            glm::vec3 position = (glm::vec3(Utils::getRandFloat(), Utils::getRandFloat(), Utils::getRandFloat()) - glm::vec3(0.5f)) * scene_size;
+            positions.set(i, position);
+            axes.set(i, glm::vec3(Utils::getRandFloat(), Utils::getRandFloat(), Utils::getRandFloat()) + glm::vec3(0.01f));
+            mins[i] = position - glm::vec3(1.0f);
+            maxs[i] = position + glm::vec3(1.0f);
+        }
+        BVH bvh;
+        bvh.build(mins, maxs);
+        Frustum frustum = Frustum(glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, scene_size));
+        std::vector<glm::mat4> models(count);
+
+        std::vector<GLfloat> vertices, reference_vertices;
+        std::vector<GLint> indices, reference_indices;
+        std::vector<int> visible;
+        CullStats stats;
+        int reference_visible = -1;
+
+        std::cout << "threads, csv parse ms, model matrices ms, cull ms (speedup over 1 thread)" << std::endl;
+        double base_ms[3] = {};
+        unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int threads = 1; threads <= max_threads; threads++) {
+            JobSystem jobs = JobSystem(threads);
+            double ms[3];
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int n = 0; n < iterations; n++) {
+                MeshCSV::parse(csv.data(), csv.size(), vertices, indices, jobs);
+            }
+            ms[0] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+
+            start = std::chrono::high_resolution_clock::now();
+            for (int n = 0; n < iterations; n++) {
+                TransformBatch::computeAxisAngle(positions, axes, n * 0.1f, models.data(), TransformBatch::detectLevel(), jobs);
+            }
+            ms[1] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+
+            start = std::chrono::high_resolution_clock::now();
+            for (int n = 0; n < iterations; n++) {
+                bvh.cull(frustum, visible, stats, jobs);
+            }
+            ms[2] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+
+            if (threads == 1) {
+                reference_vertices = vertices;
+                reference_indices = indices;
+                reference_visible = stats.Visible;
+                for (int i = 0; i < 3; i++) {
+                    base_ms[i] = ms[i];
+                }
+            }
+            else if (vertices != reference_vertices || indices != reference_indices || stats.Visible != reference_visible) {
+                std::cout << "Results on " << threads << " threads don't match 1 thread!" << std::endl;
+                return -1;
+            }
+            std::cout << threads;
+            for (int i = 0; i < 3; i++) {
+                std::cout << ", " << ms[i] << " (" << base_ms[i] / ms[i] << "x)";
+            }
+            std::cout << std::endl;
+        }
+        return 0;
+    }
+
+    //voxel terrain of chunks x 4 x chunks: palette memory per chunk, and greedy meshing throughput on 1 and every thread
+    int benchmarkVoxels(int chunks, int iterations) {
+        VoxelWorld world(glm::ivec3(chunks, 4, chunks), glm::vec3(0.0f), 1);
+        size_t chunk_count = world.getChunkCount();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        world.generateTerrain(1);
+        double generate_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        size_t bits_histogram[17] = {};
+        for (size_t i = 0; i < chunk_count; i++) {
+            bits_histogram[world.getChunk((int)i).getBits()]++;
+        }
+        size_t memory = world.getMemoryUsage();
+        std::cout << chunk_count << " chunks (" << chunk_count * VoxelChunk::VoxelCount << " voxels) generated in " << generate_ms << " ms" << std::endl;
+        std::cout << "memory: " << memory / chunk_count << " bytes per chunk, " << VoxelChunk::VoxelCount * sizeof(uint16_t) << " unpacked ("
+            << (double)chunk_count * VoxelChunk::VoxelCount * sizeof(uint16_t) / memory << "x)" << std::endl;
+        std::cout << "chunks by bits per voxel:";
+        for (int bits = 0; bits <= 16; bits++) {
+            if (bits_histogram[bits] > 0) {
+                std::cout << " " << bits << ": " << bits_histogram[bits];
+            }
+        }
+        std::cout << std::endl;
+
+        //every chunk's quads must cover exactly the faces it exposes, and every thread count must agree on them
+        std::vector<int> reference_faces, reference_quads;
+        double base_rate = 0.0;
+        std::vector<unsigned int> thread_counts = { 1 };
+        if (std::thread::hardware_concurrency() > 1) {
+            thread_counts.push_back(std::thread::hardware_concurrency());
+        }
+        for (unsigned int threads : thread_counts) {
+            JobSystem jobs = JobSystem(threads);
+            std::vector<int> faces(chunk_count), quads(chunk_count), areas(chunk_count);
+            start = std::chrono::high_resolution_clock::now();
+            for (int n = 0; n < iterations; n++) {
+                jobs.parallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+                    std::vector<uint16_t> padded((size_t)VoxelMesher::PaddedSize * VoxelMesher::PaddedSize * VoxelMesher::PaddedSize);
+                    VoxelMesher::Mesh mesh;
+                    for (size_t i = begin; i < end; i++) {
+                        world.gatherPadded((int)i, padded.data());
+                        VoxelMesher::build(padded.data(), world.getBlockLayers(), mesh);
+                        faces[i] = mesh.Faces;
+                        quads[i] = (int)mesh.Vertices.size() / 4;
+                        areas[i] = 0;
+                        for (size_t v = 2; v < mesh.Vertices.size(); v += 4) { //third corner's tex coord is the quad's size in blocks
+                            areas[i] += mesh.Vertices[v].TexCoord[0] * mesh.Vertices[v].TexCoord[1];
+                        }
+                    }
+                });
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+            double rate = chunk_count / seconds;
+            if (threads == 1) {
+                base_rate = rate;
+                reference_faces = faces;
+                reference_quads = quads;
+            }
+            else if (faces != reference_faces || quads != reference_quads) {
+                std::cout << "Meshes on " << threads << " threads don't match 1 thread!" << std::endl;
+                return -1;
+            }
+            if (areas != faces) {
+                std::cout << "Greedy quads don't cover the visible faces exactly!" << std::endl;
+                return -1;
+            }
+            int64_t total_faces = 0, total_quads = 0;
+            for (size_t i = 0; i < chunk_count; i++) {
+                total_faces += faces[i];
+                total_quads += quads[i];
+            }
+            std::cout << threads << " threads: " << rate << " chunks meshed/s (" << rate / base_rate << "x), " << total_faces << " visible faces in " << total_quads
+                << " quads (" << (double)total_faces / std::max<int64_t>(1, total_quads) << " faces per quad)" << std::endl;
+        }
+        return 0;
+    }
+
+    //occlusion pass over count unit boxes spread through a cube, viewed from its centre: the nearest 32 are occluders, every box inside
+    //the frustum is tested. times each instruction set on 1 thread, then the best on every thread, checking they all agree and that
+    //sse4.1 on 1 thread is within OcclusionBuffer::BudgetMs
+    int benchmarkOcclusion(int count, int iterations) {
+        const int MaxOccluders = 32;
+        std::vector<glm::vec3> box_positions;
+        std::vector<uint32_t> box_indices;
+        for (int corner = 0; corner < 8; corner++) {
+            box_positions.push_back(glm::vec3(corner & 1 ? 0.5f : -0.5f, corner & 2 ? 0.5f : -0.5f, corner & 4 ? 0.5f : -0.5f));
+        }
+        const uint32_t faces[6][4] = { { 0, 2, 6, 4 }, { 1, 5, 7, 3 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 6, 7, 5 } };
+        for (int f = 0; f < 6; f++) {
+            box_indices.insert(box_indices.end(), { faces[f][0], faces[f][1], faces[f][2], faces[f][0], faces[f][2], faces[f][3] });
+        }
+
+        float scene_size = 8.0f * cbrt(count / 10.0f);
+        std::vector<glm::mat4> models(count);
+        std::vector<glm::vec3> mins(count), maxs(count);
+        for (int i = 0; i < count; i++) {
+            glm::vec3 position = (glm::vec3(Utils::getRandFloat(), Utils::getRandFloat(), Utils::getRandFloat()) - glm::vec3(0.5f)) * scene_size;
+            models[i] = glm::translate(glm::mat4(1.0f), position);
+            mins[i] = position - glm::vec3(0.5f);
+            maxs[i] = position + glm::vec3(0.5f);
+        }
+        BVH bvh;
+        bvh.build(mins, maxs);
+        glm::mat4 view_proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, scene_size);
+        std::vector<int> visible;
+        CullStats stats;
+        bvh.cull(Frustum(view_proj), visible, stats, JobSystem::getDefault());
+        std::vector<std::pair<float, int>> candidates;
+        for (int index : visible) {
+            candidates.push_back(std::make_pair(glm::length(mins[index] + glm::vec3(0.5f)), index));
+        }
+        std::sort(candidates.begin(), candidates.end());
+        size_t occluder_count = std::min(candidates.size(), (size_t)MaxOccluders);
+
+        std::cout << visible.size() << " of " << count << " boxes in the frustum, " << occluder_count << " occluders" << std::endl;
+        std::cout << "level x threads: occlusion pass ms (rasterize ms), occluded" << std::endl;
+        std::vector<float> reference_depth;
+        std::vector<uint8_t> reference_visible;
+        std::vector<uint8_t> results(visible.size());
+        double budget_ms = -1.0; //sse4.1 on one thread, the path the budget is for
+        JobSystem single_thread = JobSystem(1);
+        OcclusionBuffer occlusion;
+        for (int level = TransformBatch::LevelScalar; level <= TransformBatch::detectLevel() + 1; level++) {
+            bool threaded = level > TransformBatch::detectLevel(); //final pass is the best level on every thread
+            TransformBatch::Level kernel_level = threaded ? TransformBatch::detectLevel() : (TransformBatch::Level)level;
+            if (kernel_level == TransformBatch::LevelAVX && !threaded) {
+                continue; //the rasterizer's widest path is sse4.1, same as the level below
+            }
+            JobSystem& jobs = threaded ? JobSystem::getDefault() : single_thread;
+            double raster_ms = 0.0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int n = 0; n < iterations; n++) {
+                auto raster_start = std::chrono::high_resolution_clock::now();
+                occlusion.begin(view_proj);
+                for (size_t i = 0; i < occluder_count; i++) {
+                    occlusion.addOccluder(models[candidates[i].second], box_positions, box_indices);
+                }
+                occlusion.rasterize(jobs, kernel_level);
+                raster_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - raster_start).count();
+                jobs.parallelFor(visible.size(), TransformBatch::MinObjectsPerJob, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++) {
+                        results[i] = occlusion.isVisible(mins[visible[i]], maxs[visible[i]]);
+                    }
+                });
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+            std::vector<float> depth(occlusion.getDepth(), occlusion.getDepth() + OcclusionBuffer::Width * OcclusionBuffer::Height);
+            if (reference_depth.empty()) {
+                reference_depth = depth;
+                reference_visible = results;
+            }
+            else if (depth != reference_depth || results != reference_visible) {
+                std::cout << "Occlusion results at " << TransformBatch::getLevelName(kernel_level) << " x" << jobs.getThreadCount() << " don't match scalar!" << std::endl;
+                return -1;
+            }
+            size_t occluded = std::count(results.begin(), results.end(), (uint8_t)0);
+            std::cout << TransformBatch::getLevelName(kernel_level) << " x" << jobs.getThreadCount() << ": " << ms << " (" << raster_ms / iterations << "), "
+                << occluded << " (" << 100.0 * occluded / std::max<size_t>(1, results.size()) << "%)" << std::endl;
+            if (kernel_level == TransformBatch::LevelSSE41 && !threaded) {
+                budget_ms = ms;
+            }
+        }
+        if (budget_ms < 0.0) {
+            std::cout << "No sse4.1 on this cpu, the " << OcclusionBuffer::BudgetMs << " ms budget doesn't apply" << std::endl;
+        }
+        else if (budget_ms > OcclusionBuffer::BudgetMs) {
+            std::cout << "The sse4.1 pass took " << budget_ms << " ms, over its " << OcclusionBuffer::BudgetMs << " ms budget!" << std::endl;
+            return -1;
+        }
+        else {
+            std::cout << "The sse4.1 pass is within its " << OcclusionBuffer::BudgetMs << " ms budget" << std::endl;
+        }
+        return 0;
+    }
+}
+
+int runWorld(Program& main_program, SDL_Window* window, HeadlessContext& headless_context, std::chrono::high_resolution_clock::time_point start_time);
+
+int main(int argc, char* argv[]) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    JobSystem::getDefault(); //create the shared job system first, so the main thread is the one that owns it
 
     /******************************************************
-    * set up shaders and shader program
+    * command line tools
+    * world --convert-mesh <in.csv> <out.mesh> [--no-optimize] [--format full|compact|unorm]
+    * world --check-vertex-formats <in.csv>
+    * world --bench-mesh <in.csv> [iterations]
+    * world --bench-csv <in.csv> [iterations]
+    * world --bench-transforms [count] [iterations]
+    * world --bench-jobs [count] [iterations]
+    * world --bench-voxels [chunks] [iterations]
+    * world --bench-occlusion [count] [iterations]
+    * world --bake-textures <image> [image...]
+    * world --pack <out.wpak> <file> [file...] [--no-compress]
     ******************************************************/
-    std::string vert_string = Utils::readFile("example.vert");
-    const char* vert_c_string = vert_string.c_str();
-
-    std::string frag_string = Utils::readFile("example.frag");
-    const char* frag_c_string = frag_string.c_str();
-
-    //create vertex shader
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER); //store unique shader ID
-    glShaderSource(vertexShader, 1, &vert_c_string, NULL); //set shader source code
-    glCompileShader(vertexShader); //compile shader
-    int  success; //shader compilation error handling
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    //create fragment shader
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &frag_c_string, NULL);
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    //create shader program (linking vertex and fragment shaders)
-    GLuint shaderProgram = glCreateProgram(); //store unique program ID
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success); //shader program linking error handling
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-
-    //delete shaders now they have been linked into shader object
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+
+    if (argc >= 4 && std::string(argv[1]) == "--convert-mesh") {
+        bool optimize = true;
+        VertexFormat::Format format = VertexFormat::getCompactFormat();
+        for (int i = 4; i < argc; i++) {
+            std::string option = argv[i];
+            if (option == "--no-optimize") {
+                optimize = false;
+            }
+            else if (option == "--format" && i + 1 < argc) {
+                std::string name = argv[++i];
+                format = name == "full" ? VertexFormat::getFullFormat() : name == "unorm" ? VertexFormat::Format{ VertexFormat::PositionUnorm16, VertexFormat::TexCoordUnorm16 } : VertexFormat::getCompactFormat();
+            }
+        }
+        return Tools::convertMesh(argv[2], argv[3], optimize, format);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--check-vertex-formats") {
+        return Tools::checkVertexFormats(argv[2]);
+    }
+    if (argc >= 5 && std::string(argv[1]) == "--check-resources") {
+        return Tools::checkResources(argv[2], argv[3], argv[4]);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--bench-mesh") {
+        return Tools::benchmarkMeshLoad(argv[2], argc >= 4 ? std::max(1, atoi(argv[3])) : 100);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--bench-csv") {
+        return Tools::benchmarkCSVParse(argv[2], argc >= 4 ? std::max(1, atoi(argv[3])) : 10);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--bake-textures") {
+        return Tools::bakeTextures(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--pack") {
+        std::vector<std::string> filenames;
+        bool compress = true;
+        for (int i = 3; i < argc; i++) {
+            if (std::string(argv[i]) == "--no-compress") {
+                compress = false;
+            }
+            else {
+                filenames.push_back(argv[i]);
+            }
+        }
+        return Tools::packAssets(argv[2], filenames, compress);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--bench-jobs") {
+        return Tools::benchmarkJobs(argc >= 3 ? std::max(1, atoi(argv[2])) : 1000000, argc >= 4 ? std::max(1, atoi(argv[3])) : 10);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--bench-voxels") {
+        return Tools::benchmarkVoxels(argc >= 3 ? std::max(1, atoi(argv[2])) : 16, argc >= 4 ? std::max(1, atoi(argv[3])) : 3);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--bench-occlusion") {
+        return Tools::benchmarkOcclusion(argc >= 3 ? std::max(1, atoi(argv[2])) : 100000, argc >= 4 ? std::max(1, atoi(argv[3])) : 100);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--bench-transforms") {
+        return Tools::benchmarkTransforms(argc >= 3 ? std::max(1, atoi(argv[2])) : 1000000, argc >= 4 ? std::max(1, atoi(argv[3])) : 10);
+    }
+
+    Program main_program = Program(1280, 720, "World Engine");
+    main_program.parseOptions(argc, argv);
+
+    //every asset below is read through the virtual file system, out of the package where it has them (before any loader thread starts)
+    if (VirtualFileSystem::getDefault().mount(main_program.PackageFilename)) {
+        std::cout << "Mounted " << main_program.PackageFilename << std::endl;
+    }
 
     /******************************************************
-    * configure vertex data
+    * setup SDL and OpenGL
     ******************************************************/
 
-    MeshInstance cube = MeshInstance("cube.csv");
+    SDL_Window* window = NULL;
+    SDL_GLContext context = NULL;
+    HeadlessContext headless_context; //offscreen context and framebuffer, replaces the window in headless mode
 
-    //create vertex array object (VAO) to store all info for a set of vertices
-    GLuint VAO;
-    glGenVertexArrays(1, &VAO); //get 1 vertex array object ID
-    glBindVertexArray(VAO); //bind this vertex array so that VBO configuration gets added to this object
-
-    //send vertex data to the gpu
-    GLuint VBO; //variable to store a unique vertex buffer object IDs
-    glGenBuffers(1, &VBO); //get 1 buffer object ID
-    glBindBuffer(GL_ARRAY_BUFFER, VBO); //bind buffer type to vertex buffer object (VBO)
-    glBufferData(GL_ARRAY_BUFFER, cube.getVertexDataSize(), cube.VertexData.data(), GL_STATIC_DRAW);
+    if (main_program.Headless) {
+        if (!headless_context.create(main_program.ScreenWidth, main_program.ScreenHeight)) {
+            return -1;
+        }
+    }
+    else {
+        if (SDL_Init(SDL_INIT_VIDEO) < 0){
+            std::cout << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+            SDL_Quit();
+            return -1;
+        }
 
-    //make element buffer object for storing vertex indices
-    GLuint EBO; 
-    glGenBuffers(1, &EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cube.getIndexDataSize(), cube.IndexData.data(), GL_STATIC_DRAW);
+        //specify OpenGL version and profile
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+        window = SDL_CreateWindow(
+            main_program.Name.c_str(), 
+            SDL_WINDOWPOS_UNDEFINED, 
+            SDL_WINDOWPOS_UNDEFINED, 
+            main_program.ScreenWidth, 
+            main_program.ScreenHeight, 
+            SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL);
+        if (window == NULL){
+            std::cout << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+            SDL_Quit();
+            return -1;
+        }
 
-    //specify how to attach vertex attributes to vertex shader (using data currently bound to GL_ARRAY_BUFFER)
-    GLint pos_index = glGetAttribLocation(shaderProgram, "in_position"); //query index of "in_position" input variable in the shader program
-    glVertexAttribPointer(pos_index, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), 0);
-    glEnableVertexAttribArray(pos_index); //enable vertex attribute aPos at location "0"
+        context = SDL_GL_CreateContext(window);
+        if (context == NULL) {
+            std::cout << "Context could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+            SDL_Quit();
+            return -1;
+        }
 
-    GLint tex_index = glGetAttribLocation(shaderProgram, "in_tex_coord");
-    glVertexAttribPointer(tex_index, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(tex_index);
+        if (gladLoadGLLoader(SDL_GL_GetProcAddress) < 0) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            SDL_Quit();
+            return -1;
+        }
+    }
 
     /******************************************************
-    * configure texture data (using stb image library https://github.com/nothings/stb)
+    * setting misc SDL and OpenGL settings
     ******************************************************/
 
-    //image reading setting
-    stbi_set_flip_vertically_on_load(true);
+    if (!main_program.Headless) {
+        SDL_SetRelativeMouseMode(SDL_TRUE); //keep mouse in screen
+    }
 
-    //vars
-    int tex_width, tex_height, tex_channel_num;
-    stbi_uc* tex_data;
+    glClearColor(0.5f, 0.5f, 0.5f, 1.0f); //set clear color to grey 
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); //set drawing mode
+    glEnable(GL_DEPTH_TEST); //enable z-buffer depth testing
 
-    //allocate memory and get ids
-    GLuint textures[2];
-    glGenTextures(2, textures);
+    //everything that owns gl objects lives in runWorld, so it's all destroyed before the context it was made in
+    int result = runWorld(main_program, window, headless_context, start_time);
 
-    ///////////////////////////////////
+    if (context) {
+        SDL_GL_DeleteContext(context);
+    }
+    if (window) {
+        SDL_DestroyWindow(window);
+    }
+    headless_context.destroy();
+    SDL_Quit();
 
-    glBindTexture(GL_TEXTURE_2D, textures[0]); //bind first ID as current texture
+    return result;
+}
 
-    //set texture settings
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT); //set texture wrapping setting, for 2D textures, in X(S) and Y(T) axes, to mirrored repeating
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); //bilinear interpolation when magnifying textures to produce pixel color
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); //trilinear interpolation (using mipmaps) when minifying textures to produce pixel color
+int runWorld(Program& main_program, SDL_Window* window, HeadlessContext& headless_context, std::chrono::high_resolution_clock::time_point start_time) {
+    /******************************************************
+    * set up shaders and shader program
+    ******************************************************/
+    //every program starts compiling (or loading from the shader cache) here, they're finished once the cube mesh has loaded
+    auto shader_start_time = std::chrono::high_resolution_clock::now();
+    ShaderProgram::enableParallelCompile();
+
+    //cube programs come in example.frag variants, the cheapest one that draws the same picture is picked every frame. their constant
+    //uniforms are set once each variant links
+    MeshFile::Dequantization cube_dequantize = {}; //filled in once the cube mesh has loaded, before any variant is set up
+    auto setupCubeProgram = [&](ShaderProgram& program) {
+        program.setInt("textures", 0); //the texture array is bound to GL_TEXTURE0
+        program.setVec4("tex_coord_transform", glm::vec4(cube_dequantize.TexCoordScale[0], cube_dequantize.TexCoordScale[1], cube_dequantize.TexCoordBias[0], cube_dequantize.TexCoordBias[1]));
+        program.setFloat("spin_rate", -(float)M_PI / 2.0f); //the rest are only used by the gpu animated programs (same spin as the cpu path)
+        program.setVec3("position_scale", glm::vec3(cube_dequantize.PositionScale[0], cube_dequantize.PositionScale[1], cube_dequantize.PositionScale[2]));
+        program.setVec3("position_bias", glm::vec3(cube_dequantize.PositionBias[0], cube_dequantize.PositionBias[1], cube_dequantize.PositionBias[2]));
+    };
+    std::vector<std::string> cube_features = { "TEXTURED", "BLEND" };
+    ShaderVariants cube_variants = ShaderVariants("example.vert", "example.frag", cube_features, setupCubeProgram, main_program.ShaderCache); //one draw call per cube, model matrix as a uniform
+    ShaderVariants instanced_variants = ShaderVariants("example_instanced.vert", "example.frag", cube_features, setupCubeProgram, main_program.ShaderCache); //one draw call for all cubes, model matrix as an instance attribute
+    ShaderVariants animated_variants = ShaderVariants("example_animated.vert", "example.frag", cube_features, setupCubeProgram, main_program.ShaderCache); //one draw call for all cubes, model matrix built from time and static instance data
+    for (ShaderVariants* variants : { &cube_variants, &instanced_variants, &animated_variants }) {
+        for (uint32_t mask : { 0u, FeatureTextured, FeatureTextured | FeatureBlend }) {
+            variants->start(mask);
+        }
+    }
+    ShaderProgram voxelShaderProgram = ShaderProgram("voxel.vert", "voxel.frag", "", main_program.ShaderCache); //voxel terrain, one draw call per chunk
+    std::chrono::duration<double, std::milli> shader_start_elapsed = std::chrono::high_resolution_clock::now() - shader_start_time;
 
-    tex_data = stbi_load("sea_texture.jpg", &tex_width, &tex_height, &tex_channel_num, 0); //read texture data from file
-    if (tex_data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tex_width, tex_height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex_data); //read texture data into texture
-        glGenerateMipmap(GL_TEXTURE_2D); //automatically generate mipmaps
-        stbi_image_free(tex_data); //free image data
+    //data rewritten every frame (view and projection matrices shared by every program through a uniform block, instance model matrices)
+    //is written straight into a ring of per frame segments, so the cpu never waits on the gpu still reading the previous frames
+    StreamBuffer stream_buffer = StreamBuffer(main_program.CubeCount * (sizeof(glm::mat4) + sizeof(CubeLayers)) + sizeof(CameraBlock));
+    GLint uniform_alignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+
+    /******************************************************
+    * configure vertex data
+    ******************************************************/
+
+    if (!VirtualFileSystem::getDefault().isPacked("cube.mesh") && (Utils::isOutOfDate("cube.csv", "cube.mesh") || !MeshFile::isCurrent("cube.mesh"))) { //first run (or edited source, or older format), convert to the binary format
+        Tools::convertMesh("cube.csv", "cube.mesh");
     }
-    else {
-        std::cout << "Failed to load texture" << std::endl;
+    ResourceManager resources;
+    std::shared_ptr<MeshResource> cube_mesh = resources.loadMesh("cube.mesh");
+    MeshInstance& cube = cube_mesh->Mesh;
+    if (!cube.isLoaded()) {
+        return -1;
+    }
+    cube_dequantize = cube.getDequantization(); //positions are folded into the model matrices, tex coords undone in the vertex shader
+    for (size_t i = 0; i < cube.LODs.size(); i++) {
+        std::cout << "cube lod " << i << ": " << cube.LODs[i].IndexCount / 3 << " triangles, error " << cube.LODs[i].Error << std::endl;
     }
 
-    ///////////////////////////////////
+    //finish whichever programs the driver is done with first, only blocking when none are
+    auto shader_finish_time = std::chrono::high_resolution_clock::now();
+    std::vector<ShaderProgram*> unfinished_programs = { &voxelShaderProgram };
+    for (ShaderVariants* variants : { &cube_variants, &instanced_variants, &animated_variants }) {
+        std::vector<ShaderProgram*> started = variants->getStarted();
+        unfinished_programs.insert(unfinished_programs.end(), started.begin(), started.end());
+    }
+    int program_count = (int)unfinished_programs.size();
+    int cached_programs = 0;
+    while (!unfinished_programs.empty()) {
+        size_t ready = 0;
+        while (ready + 1 < unfinished_programs.size() && !unfinished_programs[ready]->isReady()) {
+            ready++;
+        }
+        cached_programs += unfinished_programs[ready]->isFromCache() ? 1 : 0;
+        unfinished_programs[ready]->finish(); //failures are reported, and draw nothing
+        unfinished_programs.erase(unfinished_programs.begin() + ready);
+    }
+    std::chrono::duration<double, std::milli> shader_finish_elapsed = std::chrono::high_resolution_clock::now() - shader_finish_time;
+    double shader_ms = shader_start_elapsed.count() + shader_finish_elapsed.count();
+    std::cout << "shader compile/link: " << shader_ms << " ms (" << shader_start_elapsed.count() << " ms starting, " << shader_finish_elapsed.count() << " ms finishing), "
+        << cached_programs << " of " << program_count << " programs from cache" << std::endl;
+
+    //the cube's vertex array already has its vertex and index buffers and mesh attributes set up
+    glBindVertexArray(cube_mesh->VertexArray);
+
+    //per-instance model matrices, read once per instance (divisor 1) rather than once per vertex. they're streamed to a different offset
+    //every frame, so the attribute pointers are set before each draw
+    for (int column = 0; column < 4; column++) {
+        glEnableVertexAttribArray(InstanceModelLocation + column);
+        glVertexAttribDivisor(InstanceModelLocation + column, 1);
+    }
+    glEnableVertexAttribArray(InstanceLayersLocation); //per-instance texture layers, streamed alongside the matrices
+    glVertexAttribDivisor(InstanceLayersLocation, 1);
 
-    glBindTexture(GL_TEXTURE_2D, textures[1]); //bind second ID as current texture
+    /******************************************************
+    * configure texture data (using stb image library https://github.com/nothings/stb)
+    ******************************************************/
 
-    //set texture settings
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    //image reading setting (set before any worker starts decoding)
+    stbi_set_flip_vertically_on_load(true);
 
-    tex_data = stbi_load("payday.jpg", &tex_width, &tex_height, &tex_channel_num, 0);
-    if (tex_data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tex_width, tex_height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex_data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(tex_data);
+    //textures are layers of one texture array, so every cube can pick its own pair and still share a single binding (and a single instanced draw).
+    //layers show a grey placeholder until their mip chain cache has been mapped (or built) and resampled on a worker thread and uploaded by texture_loader.update()
+    TextureLoader texture_loader;
+    TextureArrayManager texture_arrays = TextureArrayManager(texture_loader, 512); //every image here is at least 512, so they share one 512 bucket
+    std::vector<TextureArrayManager::Handle> texture_handles; //keep the layers reserved
+    std::vector<int> texture_layers;
+    int texture_bucket = -1;
+    std::string texture_filenames[] = { "sea_texture.jpg", "payday.jpg", "oil_texture.jpg" };
+    for (std::string filename : texture_filenames) {
+        TextureArrayManager::Handle layer = texture_arrays.add(filename);
+        if (layer->Bucket < 0 || (texture_bucket >= 0 && layer->Bucket != texture_bucket)) {
+            continue; //one array binding per draw, images in other buckets can't be mixed in
+        }
+        texture_bucket = layer->Bucket;
+        texture_layers.push_back(layer->Index);
+        texture_handles.push_back(layer);
     }
-    else {
-        std::cout << "Failed to load texture 2" << std::endl;
+    uint64_t dedup_saved_bytes = resources.report(texture_arrays);
+    if (texture_layers.empty()) {
+        std::cout << "No textures loaded" << std::endl;
+        return -1;
     }
+    GLuint texture_array = texture_arrays.getTexture(texture_bucket);
 
-    ///////////////////////////////////
+    voxelShaderProgram.use(); //choose shader program to use (before setting texture uniforms)
+    voxelShaderProgram.setInt("textures", 0); //set uniform (the texture array is bound to GL_TEXTURE0)
 
-    glUseProgram(shaderProgram); //choose shader program to use (before setting texture uniforms)
-    glUniform1i(glGetUniformLocation(shaderProgram, "sea_texture"), 0); //set uniform (sea_texture is intended to be GL_TEXTURE0 so we bind a 0)
-    glUniform1i(glGetUniformLocation(shaderProgram, "payday_texture"), 1);
+    //locations used every frame
+    GLint voxel_model_location = voxelShaderProgram.getUniformLocation("model");
 
     /******************************************************
     * enter rendering loop
     ******************************************************/
     bool running = true;
 
-    float last_time = 0.0f;
-    float time = 0.0f;
+    float time = 0.0f; //wall clock seconds, for the frame rate readout
 
-    float move_speed = 5.0f;
-    float fast_mult = 2.0f;
-    float look_sensitivity = 0.2f;
-    float zoom_sensitivity = 2.0f;
+    WorldState initial_world;
+    initial_world.Camera = FPSCamera(glm::radians(45.0f), main_program.getAspectRatio(), 0.1f, main_program.VoxelChunks > 0 ? 400.0f : 100.0f); //terrain reaches further than the cubes
+    initial_world.MixVal = 1.0f;
+    initial_world.Time = 0.0f;
 
-    FPSCamera cam = FPSCamera(glm::radians(45.0f), main_program.getAspectRatio(), 0.1f, 100.0f);
-
-    float mix_val = 1.0f;
+    //camera movement and animation run at a fixed rate on their own thread, the loop below only gathers input and renders
+    Simulation simulation = Simulation(initial_world, main_program.SimulationRate);
+    InputState input = InputState();
     
-    glm::vec3 cube_rotations[10];
-    for (int i = 0; i < 10; i++) {
-        cube_rotations[i] = glm::vec3(Utils::getRandFloat(), Utils::getRandFloat(), Utils::getRandFloat());
+    float scene_size = 8.0f * cbrt(main_program.CubeCount / 10.0f); //grow the scene with the cube count so density stays the same
+
+    TransformBatch::Vec3Array cube_rotations; //rotation axes, stored as structure of arrays for the batch transform kernels
+    cube_rotations.resize(main_program.CubeCount);
+    for (int i = 0; i < main_program.CubeCount; i++) {
+        cube_rotations.set(i, glm::vec3(Utils::getRandFloat(), Utils::getRandFloat(), Utils::getRandFloat()));
+    }
+    TransformBatch::Vec3Array cube_positions;
+    cube_positions.resize(main_program.CubeCount);
+    for (int i = 0; i < main_program.CubeCount; i++) {
+        cube_positions.set(i, glm::vec3((Utils::getRandFloat() - 0.5) * scene_size, (Utils::getRandFloat() - 0.5) * scene_size, (Utils::getRandFloat() - 0.5) * scene_size));
+    }
+    std::vector<glm::mat4> cube_models(main_program.CubeCount);
+    std::vector<CubeLayers> cube_layers(main_program.CubeCount); //base and overlay texture layers, mixed by mix_val
+    for (int i = 0; i < main_program.CubeCount; i++) {
+        cube_layers[i].Base = (uint16_t)texture_layers[i % texture_layers.size()];
+        cube_layers[i].Overlay = (uint16_t)texture_layers[(i + 1 + i / texture_layers.size()) % texture_layers.size()];
+    }
+
+    //the same cubes for the gpu animated path: their inputs never change, so they're uploaded once and the vertex shader turns them into
+    //model matrices from the time uniform. a second vertex array shares the cube's buffers with the instance attributes pointed here for good
+    std::vector<CubeAnimation> cube_animations(main_program.CubeCount);
+    for (int i = 0; i < main_program.CubeCount; i++) {
+        glm::vec3 position = cube_positions.get(i);
+        glm::vec3 axis = cube_rotations.get(i);
+        memcpy(cube_animations[i].Translation, &position.x, sizeof(cube_animations[i].Translation));
+        memcpy(cube_animations[i].Axis, &axis.x, sizeof(cube_animations[i].Axis));
+        cube_animations[i].Layers = cube_layers[i];
+    }
+    AnimatedCubes animated_cubes = AnimatedCubes(*cube_mesh, cube_animations);
+    cube_animations = std::vector<CubeAnimation>(); //only the gpu copy is needed from here
+
+    //cubes only spin about their own origin, so a box around the bounding sphere stays valid whatever the rotation
+    float cube_radius = cube.getBoundingRadius();
+    std::vector<glm::vec3> cube_mins(main_program.CubeCount);
+    std::vector<glm::vec3> cube_maxs(main_program.CubeCount);
+    for (int i = 0; i < main_program.CubeCount; i++) {
+        cube_mins[i] = cube_positions.get(i) - glm::vec3(cube_radius);
+        cube_maxs[i] = cube_positions.get(i) + glm::vec3(cube_radius);
+    }
+    BVH cube_bvh;
+    cube_bvh.build(cube_mins, cube_maxs); //moved cubes should call cube_bvh.updateObject() then cube_bvh.refit()
+
+    std::vector<int> visible_cubes;
+    CullStats cull_stats = {};
+
+    //voxel terrain under the cubes. chunks are meshed on worker threads and swapped in as uploads finish, b digs out a sphere in front of the camera
+    const int VoxelHeightChunks = 4;
+    float voxel_extent = (float)(main_program.VoxelChunks * VoxelChunk::Size);
+    VoxelWorld voxels = VoxelWorld(glm::ivec3(main_program.VoxelChunks, VoxelHeightChunks, main_program.VoxelChunks), glm::vec3(-0.5f * voxel_extent, -0.5f * scene_size - 40.0f, -0.5f * voxel_extent));
+    voxels.setBlockLayer(VoxelWorld::BlockWater, (uint8_t)texture_layers[0]);
+    voxels.setBlockLayer(VoxelWorld::BlockGrass, (uint8_t)texture_layers[1 % texture_layers.size()]);
+    voxels.setBlockLayer(VoxelWorld::BlockStone, (uint8_t)texture_layers[2 % texture_layers.size()]);
+    if (main_program.VoxelChunks > 0) {
+        voxels.generateTerrain(1);
+        voxels.remesh();
     }
-    glm::vec3 cube_positions[10];
-    for (int i = 0; i < 10; i++) {
-        cube_positions[i] = glm::vec3((Utils::getRandFloat() - 0.5) * 8, (Utils::getRandFloat() - 0.5) * 8, (Utils::getRandFloat() - 0.5) * 8);
+    bool dig = false;
+
+    //occluders are the full detail cube mesh (simplified levels can bulge past the real surface and hide things that are visible)
+    const int MaxOccluders = 32;
+    OcclusionBuffer occlusion;
+    std::vector<glm::vec3> cube_occluder_positions = cube.getPositions();
+    std::vector<uint32_t> cube_occluder_indices = cube.getIndices();
+    std::vector<std::pair<float, int>> occluder_candidates;
+    std::vector<uint8_t> occlusion_visible;
+
+    //draws are queued with sort keys then issued in order through a state cache, so shared program, texture and vertex array binds happen once
+    RenderQueue render_queue;
+    Material cube_material = {};
+    cube_material.Target = GL_TEXTURE_2D_ARRAY;
+    cube_material.Textures[0] = texture_array;
+    cube_material.TextureCount = 1;
+    int cube_material_index = render_queue.addMaterial(cube_material);
+    std::vector<glm::mat4> draw_models; //per draw model matrices with the mesh's dequantization folded in, kept alive until the queue executes
+
+    //level of detail per cube, kept between frames for hysteresis. visible cubes are grouped by level so each level is one instanced draw
+    const float LODHysteresis = 0.25f;
+    int lod_count = main_program.LODThreshold > 0.0f ? (int)cube.LODs.size() : 1;
+    std::vector<uint8_t> cube_lods(main_program.CubeCount, 0);
+    std::vector<size_t> lod_order; //visible cubes sorted by level
+    std::vector<size_t> lod_starts(lod_count + 1);
+
+    int frame_count = 0;
+    float fps_time = 0.0f;
+
+    int frame_index = 0;
+    bool all_resident = false;
+    double first_frame_ms = 0.0;
+
+    //when headless the window holds every measured frame, for the report. warm up frames come first, so they've left the window by the end
+    const int WarmupFrames = 8; //keeps driver start up costs (first queries, shader compiles deferred to the first draw) out of the report
+    FrameProfiler profiler = FrameProfiler(main_program.Headless ? main_program.FrameCount : 240);
+    if (!main_program.ProfileFilename.empty() && !profiler.openDump(main_program.ProfileFilename)) {
+        std::cout << "Failed to open profile dump " << main_program.ProfileFilename << std::endl;
+    }
+
+    if (main_program.Headless) { //upload every texture and voxel chunk before the first measured frame
+        while (!texture_loader.isAllResident() || !voxels.isIdle()) {
+            texture_loader.update();
+            voxels.update();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    if (!main_program.Headless) {
+        simulation.start();
     }
     
     while (running) {
-        //time calculation:
-        last_time = time;
-        time = (float)SDL_GetTicks() / 1000.0f;
-        float delta = time - last_time;
+        profiler.beginFrame();
 
-        //input handling:
+        time = (float)SDL_GetTicks() / 1000.0f;
 
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) { //SDL_PollEvent() implicitly calls SDL_PumpEvents(), necessary for below to work (I think)
-            if (event.type == SDL_KEYDOWN) {
-                //quit
-                if (event.key.keysym.sym == SDLK_ESCAPE) {
-                    running = false;
+        WorldState world;
+        if (main_program.Headless) {
+            //fixed steps and a scripted path (one lap around the middle of the scene, close enough that the far plane still reaches cubes at any scene size),
+            //so every run renders the same frames whatever the frame rate
+            world = initial_world;
+            int path_index = std::max(0, frame_index - WarmupFrames); //warm up frames hold the first pose
+            world.Time = path_index / 60.0f;
+            float lap = (float)path_index / main_program.FrameCount;
+            world.Camera.setOrbit(glm::vec3(), scene_size * 0.3f, scene_size * 0.1f, lap * 2.0f * (float)M_PI);
+        }
+        else {
+            //input handling:
+
+            SDL_Event event;
+            while (SDL_PollEvent(&event)) { //SDL_PollEvent() implicitly calls SDL_PumpEvents(), necessary for below to work (I think)
+                if (event.type == SDL_KEYDOWN) {
+                    //quit
+                    if (event.key.keysym.sym == SDLK_ESCAPE) {
+                        running = false;
+                    }
+                    if (event.key.keysym.sym == SDLK_r) {
+                        input.ResetCount++;
+                    }
+                    if (event.key.keysym.sym == SDLK_i) { //toggle instanced / per-draw rendering
+                        main_program.Instanced = !main_program.Instanced;
+                    }
+                    if (event.key.keysym.sym == SDLK_g) { //toggle animating the cubes on the gpu
+                        main_program.GPUAnimation = !main_program.GPUAnimation;
+                    }
+                    if (event.key.keysym.sym == SDLK_c) { //toggle frustum culling
+                        main_program.Culling = !main_program.Culling;
+                    }
+                    if (event.key.keysym.sym == SDLK_o) { //toggle occlusion culling
+                        main_program.OcclusionCulling = !main_program.OcclusionCulling;
+                    }
+                    if (event.key.keysym.sym == SDLK_b) { //dig into the voxel terrain
+                        dig = true;
+                    }
                 }
-                if (event.key.keysym.sym == SDLK_r) {
-                    cam = FPSCamera(glm::radians(45.0f), main_program.getAspectRatio(), 0.1f, 100.0f);
+                if (event.type == SDL_MOUSEWHEEL) { //camera zoom (fov)
+                    input.Wheel += event.wheel.y;
                 }
             }
-            if (event.type == SDL_MOUSEWHEEL) { //camera zoom (fov)
-                cam.Fov -= event.wheel.y * zoom_sensitivity * delta;
+
+            //this way of doing input events doesn't lead to juttering for smooth transitions, unlike above
+            const Uint8* state = SDL_GetKeyboardState(NULL);
+
+            //control texture mix
+            input.MixDirection = 0.0f;
+            if (state[SDL_SCANCODE_UP]) {
+                input.MixDirection += 1.0f;
+            }
+            if (state[SDL_SCANCODE_DOWN]) {
+                input.MixDirection -= 1.0f;
             }
-        }
 
-        //this way of doing input events doesn't lead to juttering for smooth transitions, unlike above
-        const Uint8* state = SDL_GetKeyboardState(NULL);
+            //camera rotation
+            int mouse_x;
+            int mouse_y;
+            Uint32 mouse_buttons = SDL_GetRelativeMouseState(&mouse_x, &mouse_y);
+            input.MouseX += mouse_x;
+            input.MouseY += mouse_y;
+
+            //camera movement
+            glm::vec3 move = glm::vec3();
+            if (state[SDL_SCANCODE_W]) {
+                move.z -= 1.0f;
+            }
+            if (state[SDL_SCANCODE_S]) {
+                move.z += 1.0f;
+            }
+            if (state[SDL_SCANCODE_A]) {
+                move.x -= 1.0f;
+            }
+            if (state[SDL_SCANCODE_D]) {
+                move.x += 1.0f;
+            }
+            if (state[SDL_SCANCODE_SPACE]) {
+                move.y += 1.0f;
+            }
+            if (state[SDL_SCANCODE_LCTRL]) {
+                move.y -= 1.0f;
+            }
+            input.Move = move;
+            input.Fast = state[SDL_SCANCODE_LSHIFT];
 
-        //control texture mix
-        if (state[SDL_SCANCODE_UP]) {
-            mix_val = Utils::clamp(mix_val + 0.005f, 0.0f, 1.0f);
-        }
-        if (state[SDL_SCANCODE_DOWN]) {
-            mix_val = Utils::clamp(mix_val - 0.005f, 0.0f, 1.0f);
+            simulation.setInput(input);
+            world = simulation.getInterpolated(); //blend of the last two simulated states
         }
 
-        //camera rotation
-        int mouse_x;
-        int mouse_y;
-        Uint32 mouse_buttons = SDL_GetRelativeMouseState(&mouse_x, &mouse_y);
-        glm::vec2 mouse_move = glm::vec2((float)mouse_x, (float)mouse_y) * look_sensitivity * delta;
-        cam.setOrientation(cam.getOrientation() + mouse_move);
+        //rendering commands:
 
-        //camera movement
-        glm::vec3 move = glm::vec3();
-        if (state[SDL_SCANCODE_W]) {
-            move.z -= 1.0f;
+        profiler.beginPass(FrameProfiler::PassClear);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); //clear screen
+        profiler.endPass();
+
+        profiler.beginPass(FrameProfiler::PassUpdate);
+
+        //view: world space -> view space (adjust to camera)
+        //proj: view space -> clip space (add perspective projection and normalize to NDCs)
+        CameraBlock camera_block;
+        camera_block.View = world.Camera.getViewMatrix();
+        camera_block.Proj = world.Camera.getProjectionMatrix();
+
+        //model: local space -> world space (adjust to world), translate(cube_positions[i]) * rotate(angle, cube_rotations[i]) for every cube at once.
+        //the gpu animated path builds these in the vertex shader instead, so it skips everything per cube below (culling, occlusion, lod and uploads)
+        bool gpu_animation = main_program.GPUAnimation;
+        bool culling = main_program.Culling && !gpu_animation;
+        if (!gpu_animation) {
+            TransformBatch::computeAxisAngle(cube_positions, cube_rotations, -world.Time * (float)M_PI / 2.0f, cube_models.data());
         }
-        if (state[SDL_SCANCODE_S]) {
-            move.z += 1.0f;
+
+        if (dig) { //edited chunks (and neighbours sharing a face with the edit) are remeshed in the background, the old meshes draw until then
+            glm::vec3 forward = -glm::vec3(camera_block.View[0][2], camera_block.View[1][2], camera_block.View[2][2]);
+            voxels.fillSphere(-world.Camera.getTranslation() + forward * 8.0f, 4.0f, VoxelWorld::BlockAir);
+            dig = false;
         }
-        if (state[SDL_SCANCODE_A]) {
-            move.x -= 1.0f;
+        profiler.endPass();
+
+        //only submit cubes inside the view frustum
+        profiler.beginPass(FrameProfiler::PassCull);
+        Frustum frustum = Frustum(camera_block.Proj * camera_block.View);
+        if (culling) {
+            cube_bvh.cull(frustum, visible_cubes, cull_stats, JobSystem::getDefault());
         }
-        if (state[SDL_SCANCODE_D]) {
-            move.x += 1.0f;
+        else {
+            cull_stats.Tested = 0;
+            cull_stats.Visible = (int)cube_models.size();
         }
-        if (state[SDL_SCANCODE_SPACE]) {
-            move.y += 1.0f;
+        int visible_count = cull_stats.Visible;
+        auto getVisibleCube = [&](size_t i) -> size_t {
+            return culling ? visible_cubes[i] : i;
+        };
+        profiler.endPass();
+
+        //then drop cubes hidden behind the nearest ones, rasterized into a small depth buffer on the cpu
+        profiler.beginPass(FrameProfiler::PassOcclusion);
+        glm::vec3 camera_position = -world.Camera.getTranslation();
+        bool occlusion_active = culling && main_program.OcclusionCulling;
+        int occlusion_tested = 0;
+        int occluded = 0;
+        if (occlusion_active) {
+            occlusion.begin(camera_block.Proj * camera_block.View);
+            occluder_candidates.clear();
+            for (int i = 0; i < visible_count; i++) { //every cube is the same size, so the nearest cover the most screen
+                occluder_candidates.push_back(std::make_pair(glm::length(cube_positions.get(visible_cubes[i]) - camera_position), visible_cubes[i]));
+            }
+            size_t occluder_count = std::min(occluder_candidates.size(), (size_t)MaxOccluders);
+            std::partial_sort(occluder_candidates.begin(), occluder_candidates.begin() + occluder_count, occluder_candidates.end());
+            for (size_t i = 0; i < occluder_count; i++) {
+                occlusion.addOccluder(cube_models[occluder_candidates[i].second], cube_occluder_positions, cube_occluder_indices);
+            }
+            occlusion.rasterize();
+
+            occlusion_visible.resize(visible_count);
+            JobSystem::getDefault().parallelFor(visible_count, TransformBatch::MinObjectsPerJob, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    occlusion_visible[i] = occlusion.isVisible(cube_mins[visible_cubes[i]], cube_maxs[visible_cubes[i]]);
+                }
+            });
+            int kept = 0;
+            for (int i = 0; i < visible_count; i++) {
+                if (occlusion_visible[i]) {
+                    visible_cubes[kept++] = visible_cubes[i];
+                }
+            }
+            occlusion_tested = visible_count;
+            occluded = visible_count - kept;
+            visible_cubes.resize(kept);
+            visible_count = kept;
+            cull_stats.Visible = kept;
         }
-        if (state[SDL_SCANCODE_LCTRL]) {
-            move.y -= 1.0f;
+        profiler.endPass();
+
+        profiler.beginPass(FrameProfiler::PassUpload);
+
+        //pick each visible cube's level by how many pixels its simplification error would cover, then group them by level (the order instances are uploaded in)
+        float pixels_per_unit = main_program.ScreenHeight / (2.0f * tanf(world.Camera.Fov / 2.0f)); //at distance 1
+        if (lod_count > 1 && !gpu_animation) {
+            JobSystem::getDefault().parallelFor(visible_count, TransformBatch::MinObjectsPerJob, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    size_t cube_index = getVisibleCube(i);
+                    float distance = glm::length(cube_positions.get(cube_index) - camera_position) - cube_radius; //nearest the mesh can be
+                    cube_lods[cube_index] = (uint8_t)MeshSimplifier::selectLevel(cube.LODs.data(), lod_count, cube_lods[cube_index], distance, pixels_per_unit, main_program.LODThreshold, LODHysteresis);
+                }
+            });
         }
-
-        if (move != glm::vec3()) {
-            if (state[SDL_SCANCODE_LSHIFT]) {
-                move = normalize(move) * move_speed * fast_mult * delta;
+        std::fill(lod_starts.begin(), lod_starts.end(), 0);
+        if (gpu_animation) { //everything at full detail, in the static buffer's order
+            std::fill(lod_starts.begin() + 1, lod_starts.end(), (size_t)visible_count);
+        }
+        else {
+            for (int i = 0; i < visible_count; i++) {
+                lod_starts[cube_lods[getVisibleCube(i)] + 1]++;
             }
-            else {
-                move = normalize(move) * move_speed * delta;
+            for (int l = 0; l < lod_count; l++) {
+                lod_starts[l + 1] += lod_starts[l];
+            }
+            lod_order.resize(visible_count);
+            std::vector<size_t> lod_fill(lod_starts.begin(), lod_starts.end() - 1);
+            for (int i = 0; i < visible_count; i++) {
+                size_t cube_index = getVisibleCube(i);
+                lod_order[lod_fill[cube_lods[cube_index]]++] = cube_index;
             }
         }
 
-        cam.relativeMove(move);
+        bool streamed_instances = main_program.Instanced && !gpu_animation;
+        size_t instance_bytes = streamed_instances ? visible_count * sizeof(glm::mat4) : 0;
+        size_t layer_bytes = streamed_instances ? visible_count * sizeof(CubeLayers) : 0;
+        stream_buffer.beginFrame(sizeof(CameraBlock) + uniform_alignment + instance_bytes + layer_bytes);
 
-        //rendering commands:
+        StreamBuffer::Allocation camera_allocation = stream_buffer.allocate(sizeof(CameraBlock), uniform_alignment);
+        if (camera_allocation.Data) {
+            memcpy(camera_allocation.Data, &camera_block, sizeof(CameraBlock));
+            glBindBufferRange(GL_UNIFORM_BUFFER, CameraBlockBinding, stream_buffer.getBuffer(), camera_allocation.Offset, sizeof(CameraBlock));
+            profiler.count(FrameProfiler::CounterStateChanges);
+        }
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); //clear screen
+        StreamBuffer::Allocation instance_allocation = { NULL, 0 };
+        StreamBuffer::Allocation layer_allocation = { NULL, 0 };
+        if (streamed_instances) {
+            //gather the visible model matrices and texture layers straight into the mapped buffer, no staging copy
+            instance_allocation = stream_buffer.allocate(instance_bytes, sizeof(glm::vec4));
+            layer_allocation = stream_buffer.allocate(layer_bytes, sizeof(CubeLayers));
+            glm::mat4* instance_models = (glm::mat4*)instance_allocation.Data;
+            CubeLayers* instance_layers = (CubeLayers*)layer_allocation.Data;
+            if (instance_models && instance_layers) {
+                JobSystem::getDefault().parallelFor(visible_count, TransformBatch::MinObjectsPerJob, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++) {
+                        size_t cube_index = lod_order[i];
+                        instance_models[i] = VertexFormat::foldDequantization(cube_models[cube_index], cube_dequantize.PositionScale, cube_dequantize.PositionBias);
+                        instance_layers[i] = cube_layers[cube_index];
+                    }
+                });
+            }
+        }
+        stream_buffer.commit();
+        voxels.remesh();
+        profiler.count(FrameProfiler::CounterBytesUploaded, voxels.update());
+        profiler.count(FrameProfiler::CounterBytesStreamed, stream_buffer.getFrameBytes());
+        profiler.count(FrameProfiler::CounterStreamWaits, stream_buffer.getFrameWaits());
+        profiler.endPass();
+
+        profiler.beginPass(FrameProfiler::PassDraw);
+
+        //placeholder grey while textures load (what the layers show anyway), one layer once the mix has settled on either end, else both
+        uint32_t cube_variant = !texture_loader.isAllResident() ? 0 : world.MixVal <= 0.0f || world.MixVal >= 1.0f ? FeatureTextured : FeatureTextured | FeatureBlend;
+        ShaderVariants& active_variants = gpu_animation ? animated_variants : main_program.Instanced ? instanced_variants : cube_variants;
+        ShaderProgram& activeProgram = active_variants.get(cube_variant);
+        render_queue.State.invalidate(); //texture uploads and stream buffer mapping bind outside the cache
+        render_queue.State.resetCounts();
+        render_queue.State.useProgram(activeProgram.getID()); //through the cache, so the queue knows it's already bound
 
-        //choose textures to use
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[0]);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        //calculate and set shader program's "uniform" variables
+        if (cube_variant & FeatureBlend) {
+            activeProgram.setFloat(activeProgram.getUniformLocation("mix_val"), world.MixVal); //sets uniform value (has to be called *after* using shader program)
+            profiler.count(FrameProfiler::CounterBytesUploaded, sizeof(float));
+        }
+        else if (cube_variant & FeatureTextured) {
+            activeProgram.setInt(activeProgram.getUniformLocation("single_layer"), world.MixVal >= 1.0f ? 1 : 0);
+            profiler.count(FrameProfiler::CounterBytesUploaded, sizeof(int));
+        }
+        if (gpu_animation) {
+            activeProgram.setFloat(activeProgram.getUniformLocation("time"), world.Time); //all the cubes need to move
+            profiler.count(FrameProfiler::CounterBytesUploaded, sizeof(float));
+        }
 
-        glUseProgram(shaderProgram); //choose shader program to use
-        glBindVertexArray(VAO); //choose vertices to use
+        render_queue.clear();
+        glm::vec4 view_depth = glm::vec4(camera_block.View[0][2], camera_block.View[1][2], camera_block.View[2][2], camera_block.View[3][2]); //dot with a position for its view space z, negative in front of the camera
+        float depth_scale = -1.0f / world.Camera.Far;
+        DrawCommand command = {};
+        command.Program = activeProgram.getID();
+        command.VertexArray = cube_mesh->VertexArray;
+        command.MaterialIndex = cube_material_index;
+        command.IndexType = cube.getIndexType();
+        size_t index_size = MeshFile::getIndexSize(command.IndexType);
+        if (gpu_animation) { //every cube in one call, straight from the static buffer
+            command.VertexArray = animated_cubes.VertexArray;
+            command.Key = render_queue.makeKey(command.Program, command.MaterialIndex, command.VertexArray, 0.0f);
+            command.IndexCount = (GLsizei)cube.LODs[0].IndexCount;
+            command.IndexOffset = (GLintptr)(cube.LODs[0].IndexOffset * index_size);
+            command.InstanceCount = visible_count;
+            command.InstanceBuffer = 0;
+            render_queue.submit(command);
+        }
+        else if (main_program.Instanced && instance_allocation.Data && layer_allocation.Data) { //every cube at a level in one call
+            command.Key = render_queue.makeKey(command.Program, command.MaterialIndex, command.VertexArray, 0.0f);
+            command.InstanceBuffer = stream_buffer.getBuffer();
+            for (int l = 0; l < lod_count; l++) {
+                if (lod_starts[l + 1] == lod_starts[l]) {
+                    continue;
+                }
+                command.IndexCount = (GLsizei)cube.LODs[l].IndexCount;
+                command.IndexOffset = (GLintptr)(cube.LODs[l].IndexOffset * index_size);
+                command.InstanceCount = (GLsizei)(lod_starts[l + 1] - lod_starts[l]);
+                command.InstanceOffset = instance_allocation.Offset + lod_starts[l] * sizeof(glm::mat4);
+                command.InstanceLayersOffset = layer_allocation.Offset + lod_starts[l] * sizeof(CubeLayers);
+                render_queue.submit(command);
+            }
+        }
+        else if (!main_program.Instanced) {
+            command.ModelLocation = activeProgram.getUniformLocation("model");
+            command.LayersLocation = activeProgram.getUniformLocation("layers"); //-1 in the untextured variant, which has no use for them
+            draw_models.resize(visible_count);
+            for (int i = 0; i < visible_count; i++) {
+                size_t cube_index = lod_order[i];
+                const MeshSimplifier::Level& level = cube.LODs[cube_lods[cube_index]];
+                command.IndexCount = (GLsizei)level.IndexCount;
+                command.IndexOffset = (GLintptr)(level.IndexOffset * index_size);
+                draw_models[i] = VertexFormat::foldDequantization(cube_models[cube_index], cube_dequantize.PositionScale, cube_dequantize.PositionBias);
+                command.Model = &draw_models[i];
+                command.Layers[0] = cube_layers[cube_index].Base;
+                command.Layers[1] = cube_layers[cube_index].Overlay;
+                float depth = glm::dot(view_depth, cube_models[cube_index][3]) * depth_scale; //from the object origin, not the dequantization corner
+                command.Key = render_queue.makeKey(command.Program, command.MaterialIndex, command.VertexArray, depth);
+                render_queue.submit(command);
+            }
+            profiler.count(FrameProfiler::CounterBytesUploaded, visible_count * (sizeof(glm::mat4) + 2 * sizeof(GLint)));
+        }
 
-        //calculate and set shader program's "uniform" variables
-        glUniform1f(glGetUniformLocation(shaderProgram, "mix_val"), mix_val); //sets uniform value (has to be called *after* using shader program)
+        int64_t voxel_triangles = 0;
+        DrawCommand chunk_command = {};
+        chunk_command.Program = voxelShaderProgram.getID();
+        chunk_command.MaterialIndex = cube_material_index; //same texture array
+        chunk_command.ModelLocation = voxel_model_location;
+        chunk_command.LayersLocation = -1;
+        for (const VoxelWorld::ChunkDraw& draw : voxels.getDraws()) {
+            int plane_mask = 0x3F;
+            if (draw.IndexCount == 0 || (main_program.Culling && !frustum.testAABB(draw.Min, draw.Max, plane_mask))) {
+                continue;
+            }
+            if (occlusion_active) {
+                occlusion_tested++;
+                if (!occlusion.isVisible(draw.Min, draw.Max)) {
+                    occluded++;
+                    continue;
+                }
+            }
+            chunk_command.VertexArray = draw.VertexArray;
+            chunk_command.IndexType = draw.IndexType;
+            chunk_command.IndexCount = draw.IndexCount;
+            chunk_command.Model = &draw.Model;
+            chunk_command.Key = render_queue.makeKey(chunk_command.Program, chunk_command.MaterialIndex, chunk_command.VertexArray, glm::dot(view_depth, glm::vec4((draw.Min + draw.Max) * 0.5f, 1.0f)) * depth_scale);
+            render_queue.submit(chunk_command);
+            voxel_triangles += draw.IndexCount / 3;
+        }
 
-        //view: world space -> view space (adjust to camera)
-        glm::mat4 view = cam.getViewMatrix();
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, value_ptr(view));
+        render_queue.sort();
+        RenderQueue::Stats queue_stats = render_queue.execute();
+        profiler.count(FrameProfiler::CounterDrawCalls, queue_stats.Draws);
+        profiler.count(FrameProfiler::CounterStateChanges, render_queue.State.Issued);
+        profiler.count(FrameProfiler::CounterStateChangesSkipped, render_queue.State.Skipped);
+        profiler.count(FrameProfiler::CounterOcclusionTested, occlusion_tested);
+        profiler.count(FrameProfiler::CounterOccluded, occluded);
+        int64_t triangles = voxel_triangles;
+        for (int l = 0; l < lod_count; l++) {
+            triangles += (int64_t)(lod_starts[l + 1] - lod_starts[l]) * (cube.LODs[l].IndexCount / 3);
+        }
+        profiler.count(FrameProfiler::CounterTriangles, triangles);
+        stream_buffer.endFrame(); //fences the segment once these draws are done with it
+        profiler.endPass();
 
-        //proj: view space -> clip space (add perspective projection and normalize to NDCs)
-        glm::mat4 proj = cam.getProjectionMatrix();
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "proj"), 1, GL_FALSE, value_ptr(proj));
+        profiler.beginPass(FrameProfiler::PassSwap);
+        if (main_program.Headless) {
+            headless_context.present(); //nothing to swap, wait for the frame to finish instead
+        }
+        else {
+            SDL_GL_SwapWindow(window); //update window using swapchain
+        }
 
-        for (int i = 0; i < std::size(cube_positions); i++) {
-            //model: local space -> world space (adjust to world)
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cube_positions[i]);
-            model = glm::rotate(model, -time * (float)M_PI / 2.0f, cube_rotations[i]); // <- rotation happens before translation above
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, value_ptr(model)); //set transformation matrices
-            glDrawElements(GL_TRIANGLES, cube.IndexData.size(), GL_UNSIGNED_INT, 0);
+        //upload any textures finished decoding, and report startup timings
+        profiler.count(FrameProfiler::CounterBytesUploaded, texture_loader.update());
+        profiler.endPass();
+        profiler.endFrame();
+        if (frame_index == 0) {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+            first_frame_ms = elapsed.count();
+            std::cout << "time to first frame: " << elapsed.count() << " ms" << std::endl;
+        }
+        if (!all_resident && texture_loader.isAllResident()) {
+            all_resident = true;
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+            std::cout << "time to all textures resident: " << elapsed.count() << " ms" << std::endl;
+        }
+        frame_index++;
+        if (main_program.Headless && frame_index >= WarmupFrames + main_program.FrameCount) {
+            running = false;
         }
 
-        SDL_GL_SwapWindow(window); //update window using swapchain
+        //show frame rate in the title bar once a second
+        frame_count++;
+        if (!main_program.Headless && time - fps_time >= 1.0f) {
+            std::string title = main_program.Name + " - " + std::to_string(main_program.CubeCount) + " cubes, " + (main_program.GPUAnimation ? "gpu animated" : main_program.Instanced ? "instanced" : "per-draw") + ", "
+                + std::to_string(cull_stats.Visible) + " visible (" + std::to_string(cull_stats.Tested) + " tested, "
+                + std::to_string((int)(100.0 * profiler.getCounterSummary(FrameProfiler::CounterOccluded).Mean / std::max(1.0, profiler.getCounterSummary(FrameProfiler::CounterOcclusionTested).Mean))) + "% occluded), " + std::to_string((int)(frame_count / (time - fps_time))) + " fps, "
+                + "cpu " + std::to_string(profiler.getCPUSummary().Mean) + " ms, gpu " + std::to_string(profiler.getGPUSummary().Mean) + " ms, "
+                + std::to_string((int)profiler.getCounterSummary(FrameProfiler::CounterDrawCalls).Mean) + " draws, "
+                + std::to_string((int64_t)profiler.getCounterSummary(FrameProfiler::CounterTriangles).Mean) + " triangles, "
+                + std::to_string((int)(profiler.getCounterSummary(FrameProfiler::CounterBytesStreamed).Mean / 1024)) + " KB streamed";
+            SDL_SetWindowTitle(window, title.c_str());
+            frame_count = 0;
+            fps_time = time;
+        }
     }
 
-    SDL_Quit();
+    if (main_program.Headless) {
+        profiler.flush(); //gpu times for the last few frames
+        BenchmarkReport::Config config;
+        const char* renderer = (const char*)glGetString(GL_RENDERER);
+        config.Renderer = renderer ? renderer : "";
+        config.Width = main_program.ScreenWidth;
+        config.Height = main_program.ScreenHeight;
+        config.CubeCount = main_program.CubeCount;
+        config.Instanced = main_program.Instanced;
+        config.GPUAnimation = main_program.GPUAnimation;
+        config.Culling = main_program.Culling;
+        config.ShaderCache = main_program.ShaderCache;
+        config.ShaderMs = shader_ms;
+        config.CachedPrograms = cached_programs;
+        config.Programs = program_count;
+        config.FirstFrameMs = first_frame_ms;
+        config.DedupSavedBytes = dedup_saved_bytes;
+        if (!BenchmarkReport::write(main_program.ReportFilename, config, profiler)) {
+            std::cout << "Failed to write benchmark report " << main_program.ReportFilename << std::endl;
+            return -1;
+        }
+        std::cout << "Wrote " << main_program.FrameCount << " frame benchmark report to " << main_program.ReportFilename << std::endl;
+        int overruns = profiler.getGPUOverruns();
+        if (overruns > 0) { //fail the run, the gpu times in the report can't be trusted
+            std::cout << overruns << " frames took longer on the gpu than on the wall clock" << std::endl;
+            return -1;
+        }
+    }
+
+    simulation.stop();
 
     return 0;
 }
\ No newline at end of file
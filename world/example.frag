@@ -1,14 +1,26 @@
 #version 330 core
 
+//features (see ShaderVariants), the cheapest variant that gives the same picture is picked per draw:
+//  neither  - flat placeholder grey, while textures are still loading
+//  TEXTURED - one layer, when mix_val has settled on one end
+//  BLEND    - both layers mixed by mix_val (with TEXTURED)
+
 in vec2 vert_tex_coord;
+flat in ivec2 vert_layers; //base and overlay layers of the texture array
 
 uniform float mix_val;
+uniform int single_layer; //which of vert_layers a TEXTURED variant without BLEND samples
 
-uniform sampler2D sea_texture;
-uniform sampler2D payday_texture;
+uniform sampler2DArray textures;
 
 out vec4 out_color;
 
 void main() {
-	out_color = mix(texture(sea_texture, vert_tex_coord), texture(payday_texture, vert_tex_coord), mix_val);
+#if defined(BLEND)
+	out_color = mix(texture(textures, vec3(vert_tex_coord, vert_layers.x)), texture(textures, vec3(vert_tex_coord, vert_layers.y)), mix_val);
+#elif defined(TEXTURED)
+	out_color = texture(textures, vec3(vert_tex_coord, vert_layers[single_layer]));
+#else
+	out_color = vec4(vec3(128.0 / 255.0), 1.0); //same as the texture array's placeholder layers
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#version 330 core
+
+in vec3 in_position;
+in vec2 in_tex_coord;
+in vec3 in_translation; //per-instance, uploaded once
+in vec3 in_axis; //per-instance spin axis, needn't be normalized
+in ivec2 in_layers; //per-instance texture array layers
+
+layout(std140) uniform Camera { //shared by every program, see CameraBlock
+    mat4 view;
+    mat4 proj;
+};
+
+uniform float time; //seconds, the only per frame input
+uniform float spin_rate; //radians per second
+uniform vec3 position_scale; //undoes position quantization (the other programs fold this into their model matrices)
+uniform vec3 position_bias;
+uniform vec4 tex_coord_transform; //xy scale, zw bias, undoes tex coord quantization
+
+out vec2 vert_tex_coord;
+flat out ivec2 vert_layers;
+
+void main() {
+    //translate(in_translation) * rotate(time * spin_rate, in_axis), as TransformBatch::computeAxisAngle builds on the cpu
+    float angle = time * spin_rate;
+    float c = cos(angle);
+    float s = sin(angle);
+    vec3 axis = normalize(in_axis);
+    vec3 temp = axis * (1.0 - c);
+    mat3 rotation = mat3(
+        c + temp.x * axis.x, temp.x * axis.y + s * axis.z, temp.x * axis.z - s * axis.y,
+        temp.y * axis.x - s * axis.z, c + temp.y * axis.y, temp.y * axis.z + s * axis.x,
+        temp.z * axis.x + s * axis.y, temp.z * axis.y - s * axis.x, c + temp.z * axis.z);
+
+    vec3 world_position = rotation * (in_position * position_scale + position_bias) + in_translation;
+    vert_tex_coord = in_tex_coord * tex_coord_transform.xy + tex_coord_transform.zw;
+    vert_layers = in_layers;
+    gl_Position = proj * view * vec4(world_position, 1);
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#version 330 core
+
+in vec3 in_position;
+in vec2 in_tex_coord;
+in mat4 in_model; //per-instance, one matrix per cube
+in ivec2 in_layers; //per-instance texture array layers
+
+layout(std140) uniform Camera { //shared by every program, see CameraBlock
+    mat4 view;
+    mat4 proj;
+};
+
+uniform vec4 tex_coord_transform; //xy scale, zw bias, undoes tex coord quantization
+
+out vec2 vert_tex_coord;
+flat out ivec2 vert_layers;
+
+void main() {
+    vert_tex_coord = in_tex_coord * tex_coord_transform.xy + tex_coord_transform.zw;
+    vert_layers = in_layers;
+    gl_Position = proj * view * in_model * vec4(in_position, 1);
+}
\ No newline at end of file
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include <SDL.h>
+
+class FrameProfiler { //cpu and gpu (GL_TIME_ELAPSED) time per pass plus per frame counters, kept for a rolling window of recent frames
+public:
+    enum Pass { //each pass can be timed at most once per frame, and passes can't nest (only one time elapsed query can be active)
+        PassClear,
+        PassUpdate, //camera and model matrices
+        PassCull,
+        PassOcclusion, //cpu rasterized occluders and hierarchical z tests
+        PassUpload, //uniform and instance buffers
+        PassDraw,
+        PassSwap, //swap (or finish when headless) and texture uploads
+        PassCount
+    };
+
+    enum Counter {
+        CounterDrawCalls,
+        CounterTriangles,
+        CounterStateChanges, //program, vertex array, buffer and texture binds
+        CounterStateChangesSkipped, //binds the render queue's state cache found redundant and didn't issue
+        CounterBytesUploaded, //copied by the driver (uniforms, buffer and texture uploads)
+        CounterBytesStreamed, //written straight into mapped stream buffer memory
+        CounterStreamWaits, //times the stream buffer had to wait for the gpu to release a segment
+        CounterOcclusionTested, //objects in the frustum tested against the occlusion buffer
+        CounterOccluded, //of those, hidden behind occluders and not drawn
+        CounterCount
+    };
+
+    struct Frame {
+        int64_t Index; //frame number, -1 for unused history slots
+        double CPUMs; //whole frame, beginFrame() to endFrame()
+        double PassCPUMs[PassCount];
+        double GPUMs; //sum of the passes, only meaningful once GPUValid
+        double PassGPUMs[PassCount];
+        bool GPUValid; //gpu times arrive QueryLatency frames late, and are dropped rather than waited for if still not ready (or impossible)
+        int64_t Counters[CounterCount];
+    };
+
+    struct Summary { //over every frame in the window with a valid sample
+        int Samples;
+        double Mean;
+        double Min;
+        double P50;
+        double P90;
+        double P95;
+        double P99;
+        double Max;
+    };
+
+    static const int QueryLatency = 4; //frames between issuing a query and reading it back, long enough that results are normally available
+
+    FrameProfiler(int history_size = 240) {
+        History.resize(std::max(1, history_size));
+        for (int i = 0; i < History.size(); i++) {
+            History[i].Index = -1;
+        }
+        FrameNumber = 0;
+        ActivePass = -1;
+        FrameStart = 0;
+        PassStart = 0;
+        TicksToMs = 1000.0 / (double)SDL_GetPerformanceFrequency();
+        LastDump = 0;
+        RejectedGPUFrames = 0;
+    }
+
+    ~FrameProfiler() {
+        if (!Queries.empty()) {
+            glDeleteQueries((GLsizei)Queries.size(), Queries.data());
+        }
+    }
+
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    static const char* getPassName(int pass) {
+        static const char* names[PassCount] = { "clear", "update", "cull", "occlusion", "upload", "draw", "swap" };
+        return names[pass];
+    }
+
+    static const char* getCounterName(int counter) {
+        static const char* names[CounterCount] = { "draw_calls", "triangles", "state_changes", "state_changes_skipped", "bytes_uploaded", "bytes_streamed", "stream_waits", "occlusion_tested", "occluded" };
+        return names[counter];
+    }
+
+    //append a one line json summary of the window to filename about once a second, from endFrame()
+    bool openDump(std::string filename) {
+        DumpFile.open(filename, std::ios::trunc);
+        LastDump = SDL_GetPerformanceCounter();
+        return DumpFile.is_open();
+    }
+
+    //must be called on the GL thread, as must beginPass() and endPass()
+    void beginFrame() {
+        if (Queries.empty()) {
+            Queries.resize(QueryLatency * PassCount);
+            glGenQueries((GLsizei)Queries.size(), Queries.data());
+            QueryFrames.assign(QueryLatency, -1);
+            QueryIssued.assign(QueryLatency * PassCount, false);
+            QueryStarts.assign(QueryLatency, 0);
+        }
+        collect(false);
+
+        int slot = (int)(FrameNumber % QueryLatency);
+        QueryFrames[slot] = -1; //anything still pending here is dropped rather than stalling on it
+        std::fill(QueryIssued.begin() + slot * PassCount, QueryIssued.begin() + (slot + 1) * PassCount, false);
+
+        Frame& frame = getCurrentFrame();
+        frame = Frame();
+        frame.Index = (int64_t)FrameNumber;
+        FrameStart = SDL_GetPerformanceCounter();
+        QueryStarts[slot] = FrameStart;
+    }
+
+    void beginPass(Pass pass) {
+        int query = (int)(FrameNumber % QueryLatency) * PassCount + pass;
+        glBeginQuery(GL_TIME_ELAPSED, Queries[query]);
+        QueryIssued[query] = true;
+        ActivePass = pass;
+        PassStart = SDL_GetPerformanceCounter();
+    }
+
+    void endPass() {
+        Uint64 now = SDL_GetPerformanceCounter();
+        glEndQuery(GL_TIME_ELAPSED);
+        getCurrentFrame().PassCPUMs[ActivePass] += (now - PassStart) * TicksToMs;
+        ActivePass = -1;
+    }
+
+    void count(Counter counter, int64_t amount = 1) {
+        getCurrentFrame().Counters[counter] += amount;
+    }
+
+    void endFrame() {
+        getCurrentFrame().CPUMs = (SDL_GetPerformanceCounter() - FrameStart) * TicksToMs;
+        QueryFrames[FrameNumber % QueryLatency] = (int64_t)FrameNumber;
+        FrameNumber++;
+
+        if (DumpFile.is_open()) {
+            Uint64 now = SDL_GetPerformanceCounter();
+            if ((now - LastDump) * TicksToMs >= 1000.0) {
+                dump();
+                LastDump = now;
+            }
+        }
+    }
+
+    void flush() { //wait for every outstanding query, so the latest frames have gpu times too
+        glFinish();
+        collect(true);
+    }
+
+    const Frame& getLastFrame() { //most recently ended frame (its gpu times won't have arrived yet)
+        return History[(FrameNumber + History.size() - 1) % History.size()];
+    }
+
+    uint64_t getFrameCount() {
+        return FrameNumber;
+    }
+
+    //frames in the window that took longer on the gpu than on the wall clock. when every frame waits for the gpu before it ends
+    //(headless) that's only possible if the timer queries are wrong
+    int getGPUOverruns() {
+        int overruns = 0;
+        for (int i = 0; i < History.size(); i++) {
+            if (History[i].Index >= 0 && History[i].Index < (int64_t)FrameNumber && History[i].GPUValid && History[i].GPUMs > History[i].CPUMs) {
+                overruns++;
+            }
+        }
+        return overruns;
+    }
+
+    uint64_t getRejectedGPUFrames() { //frames whose gpu times were thrown away as impossible
+        return RejectedGPUFrames;
+    }
+
+    //rolling statistics over the window. pass -1 is the whole frame
+    Summary getCPUSummary(int pass = -1) {
+        return summarize([pass](const Frame& frame, double& value) {
+            value = pass < 0 ? frame.CPUMs : frame.PassCPUMs[pass];
+            return true;
+        });
+    }
+
+    Summary getGPUSummary(int pass = -1) {
+        return summarize([pass](const Frame& frame, double& value) {
+            value = pass < 0 ? frame.GPUMs : frame.PassGPUMs[pass];
+            return frame.GPUValid;
+        });
+    }
+
+    Summary getCounterSummary(Counter counter) {
+        return summarize([counter](const Frame& frame, double& value) {
+            value = (double)frame.Counters[counter];
+            return true;
+        });
+    }
+
+    static double percentile(const std::vector<double>& sorted, double p) { //nearest rank
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        size_t rank = (size_t)(p * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+private:
+    std::vector<Frame> History; //ring indexed by frame number
+    uint64_t FrameNumber; //frames begun so far
+    std::vector<GLuint> Queries; //QueryLatency frames of PassCount queries
+    std::vector<int64_t> QueryFrames; //frame each query slot is waiting on the results of, -1 if none
+    std::vector<bool> QueryIssued;
+    std::vector<Uint64> QueryStarts; //cpu ticks at the start of the frame each query slot was issued in
+    int ActivePass;
+    Uint64 FrameStart;
+    Uint64 PassStart;
+    double TicksToMs;
+    std::ofstream DumpFile;
+    Uint64 LastDump;
+    uint64_t RejectedGPUFrames;
+
+    Frame& getCurrentFrame() {
+        return History[FrameNumber % History.size()];
+    }
+
+    void collect(bool wait) { //read back every query slot whose results are in (or all of them, if waiting)
+        for (int slot = 0; slot < QueryLatency; slot++) {
+            int64_t frame_number = QueryFrames[slot];
+            if (frame_number < 0) {
+                continue;
+            }
+            int last = -1;
+            for (int pass = 0; pass < PassCount; pass++) {
+                if (QueryIssued[slot * PassCount + pass]) {
+                    last = pass;
+                }
+            }
+            if (last < 0) {
+                QueryFrames[slot] = -1;
+                continue;
+            }
+            if (!wait) { //queries complete in order, so if the last one is done they all are
+                GLint available = 0;
+                glGetQueryObjectiv(Queries[slot * PassCount + last], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available) {
+                    continue;
+                }
+            }
+
+            //no pass can have taken longer on the gpu than has passed since its frame began. some drivers (llvmpipe) return garbage for the
+            //very first query, and one such frame would swamp every mean and max it's part of
+            Frame& frame = History[frame_number % History.size()];
+            bool in_window = frame.Index == frame_number;
+            double elapsed_ms = (SDL_GetPerformanceCounter() - QueryStarts[slot]) * TicksToMs;
+            double pass_ms[PassCount] = {};
+            bool possible = true;
+            for (int pass = 0; pass < PassCount; pass++) {
+                if (!QueryIssued[slot * PassCount + pass]) {
+                    continue;
+                }
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v(Queries[slot * PassCount + pass], GL_QUERY_RESULT, &nanoseconds);
+                pass_ms[pass] = nanoseconds / 1000000.0;
+                possible = possible && pass_ms[pass] <= elapsed_ms;
+            }
+            if (in_window && possible) {
+                double total = 0.0;
+                for (int pass = 0; pass < PassCount; pass++) {
+                    frame.PassGPUMs[pass] = pass_ms[pass];
+                    total += pass_ms[pass];
+                }
+                frame.GPUMs = total;
+                frame.GPUValid = true;
+            }
+            else if (!possible) {
+                RejectedGPUFrames++;
+            }
+            QueryFrames[slot] = -1;
+        }
+    }
+
+    template<typename F>
+    Summary summarize(F sample) {
+        std::vector<double> values;
+        values.reserve(History.size());
+        for (int i = 0; i < History.size(); i++) {
+            double value;
+            if (History[i].Index >= 0 && History[i].Index < (int64_t)FrameNumber && sample(History[i], value)) { //skip the frame in progress
+                values.push_back(value);
+            }
+        }
+        std::sort(values.begin(), values.end());
+
+        Summary summary = {};
+        summary.Samples = (int)values.size();
+        if (values.empty()) {
+            return summary;
+        }
+        double total = 0.0;
+        for (int i = 0; i < values.size(); i++) {
+            total += values[i];
+        }
+        summary.Mean = total / values.size();
+        summary.Min = values.front();
+        summary.P50 = percentile(values, 0.5);
+        summary.P90 = percentile(values, 0.9);
+        summary.P95 = percentile(values, 0.95);
+        summary.P99 = percentile(values, 0.99);
+        summary.Max = values.back();
+        return summary;
+    }
+
+    void dump() {
+        Summary cpu = getCPUSummary();
+        Summary gpu = getGPUSummary();
+        DumpFile << "{\"frame\": " << FrameNumber;
+        DumpFile << ", \"cpu_ms\": {\"mean\": " << cpu.Mean << ", \"p50\": " << cpu.P50 << ", \"p95\": " << cpu.P95 << ", \"p99\": " << cpu.P99 << "}";
+        DumpFile << ", \"gpu_ms\": {\"mean\": " << gpu.Mean << ", \"p50\": " << gpu.P50 << ", \"p95\": " << gpu.P95 << ", \"p99\": " << gpu.P99 << "}";
+        DumpFile << ", \"passes\": {";
+        for (int pass = 0; pass < PassCount; pass++) {
+            DumpFile << (pass ? ", " : "") << "\"" << getPassName(pass) << "\": {\"cpu_ms\": " << getCPUSummary(pass).Mean << ", \"gpu_ms\": " << getGPUSummary(pass).Mean << "}";
+        }
+        DumpFile << "}";
+        for (int counter = 0; counter < CounterCount; counter++) {
+            DumpFile << ", \"" << getCounterName(counter) << "\": " << getCounterSummary((Counter)counter).Mean;
+        }
+        DumpFile << "}" << std::endl;
+    }
+};
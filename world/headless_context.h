@@ -0,0 +1,222 @@
+#pragma once
+
+#include <iostream>
+#include <cstring>
+
+#include <glad/glad.h>
+
+#ifdef __linux__
+#define HEADLESS_CONTEXT_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <SDL.h>
+#endif
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#ifndef EGL_NO_CONFIG_KHR
+#define EGL_NO_CONFIG_KHR ((EGLConfig)0)
+#endif
+
+class HeadlessContext { //OpenGL 3.3 core context with no window, rendering into an offscreen framebuffer object
+#ifdef HEADLESS_CONTEXT_EGL
+    EGLDisplay Display;
+    EGLContext Context;
+#else
+    SDL_Window* Window; //never shown, only there to own the context
+    SDL_GLContext Context;
+#endif
+    GLuint Framebuffer;
+    GLuint ColorBuffer;
+    GLuint DepthBuffer;
+    int Width;
+    int Height;
+
+public:
+    HeadlessContext() {
+#ifdef HEADLESS_CONTEXT_EGL
+        Display = EGL_NO_DISPLAY;
+        Context = EGL_NO_CONTEXT;
+#else
+        Window = NULL;
+        Context = NULL;
+#endif
+        Framebuffer = 0;
+        ColorBuffer = 0;
+        DepthBuffer = 0;
+        Width = 0;
+        Height = 0;
+    }
+
+    ~HeadlessContext() {
+        destroy();
+    }
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    //create the context, load GL functions and bind a width x height framebuffer for all following draws
+    bool create(int width, int height) {
+        Width = width;
+        Height = height;
+        if (!createContext()) {
+            destroy();
+            return false;
+        }
+
+        glGenRenderbuffers(1, &ColorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, ColorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glGenRenderbuffers(1, &DepthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, DepthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &Framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ColorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DepthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Offscreen framebuffer is incomplete" << std::endl;
+            destroy();
+            return false;
+        }
+        glViewport(0, 0, width, height);
+        return true;
+    }
+
+    void destroy() {
+        if (Framebuffer) {
+            glDeleteFramebuffers(1, &Framebuffer);
+            glDeleteRenderbuffers(1, &ColorBuffer);
+            glDeleteRenderbuffers(1, &DepthBuffer);
+            Framebuffer = 0;
+            ColorBuffer = 0;
+            DepthBuffer = 0;
+        }
+#ifdef HEADLESS_CONTEXT_EGL
+        if (Display != EGL_NO_DISPLAY) {
+            eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (Context != EGL_NO_CONTEXT) {
+                eglDestroyContext(Display, Context);
+            }
+            eglTerminate(Display);
+        }
+        Display = EGL_NO_DISPLAY;
+        Context = EGL_NO_CONTEXT;
+#else
+        if (Context) {
+            SDL_GL_DeleteContext(Context);
+        }
+        if (Window) {
+            SDL_DestroyWindow(Window);
+        }
+        Window = NULL;
+        Context = NULL;
+#endif
+    }
+
+    //stands in for SDL_GL_SwapWindow, waits for the gpu so frame times include rendering
+    void present() {
+        glFinish();
+    }
+
+    int getWidth() {
+        return Width;
+    }
+
+    int getHeight() {
+        return Height;
+    }
+
+private:
+#ifdef HEADLESS_CONTEXT_EGL
+    static void* getProcAddress(const char* name) {
+        return (void*)eglGetProcAddress(name);
+    }
+
+    bool createContext() {
+        //surfaceless Mesa needs no display server or gpu (llvmpipe), otherwise take whatever the default display is
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (get_platform_display) {
+            Display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        }
+        if (Display == EGL_NO_DISPLAY) {
+            Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        EGLint major, minor;
+        if (Display == EGL_NO_DISPLAY || !eglInitialize(Display, &major, &minor)) {
+            std::cout << "Failed to initialize EGL display (error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+            Display = EGL_NO_DISPLAY;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            std::cout << "EGL has no desktop OpenGL support" << std::endl;
+            return false;
+        }
+
+        //we never create a surface, so no config is needed where EGL_KHR_no_config_context allows it. otherwise ask for pbuffer support,
+        //the surface type otherwise defaults to windows, which surfaceless displays have no configs for
+        EGLConfig config = EGL_NO_CONFIG_KHR;
+        const char* extensions = eglQueryString(Display, EGL_EXTENSIONS);
+        if (!extensions || !strstr(extensions, "EGL_KHR_no_config_context")) {
+            EGLint config_attribs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+            EGLint config_count = 0;
+            if (!eglChooseConfig(Display, config_attribs, &config, 1, &config_count) || config_count == 0) {
+                std::cout << "No suitable EGL config" << std::endl;
+                return false;
+            }
+        }
+
+        EGLint context_attribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        Context = eglCreateContext(Display, config, EGL_NO_CONTEXT, context_attribs);
+        if (Context == EGL_NO_CONTEXT) {
+            std::cout << "Failed to create EGL context (error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+            return false;
+        }
+        if (!eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, Context)) { //EGL_KHR_surfaceless_context
+            std::cout << "Failed to make EGL context current without a surface" << std::endl;
+            return false;
+        }
+
+        if (!gladLoadGLLoader(getProcAddress)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return false;
+        }
+        return true;
+    }
+#else
+    bool createContext() { //no EGL here, fall back to a hidden window
+        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+            std::cout << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+        Window = SDL_CreateWindow("", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 1, 1, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL);
+        if (Window == NULL) {
+            std::cout << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        Context = SDL_GL_CreateContext(Window);
+        if (Context == NULL) {
+            std::cout << "Context could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+        if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return false;
+        }
+        return true;
+    }
+#endif
+};
@@ -0,0 +1,296 @@
+#pragma once
+
+/*
+work stealing job scheduler. every thread taking part has its own deque: it pushes and pops jobs at the bottom (newest first, so nested
+work stays cache hot) while idle threads steal from the top (oldest first, so they take the biggest remaining pieces). the thread that
+creates the system is thread 0 and joins in whenever it waits on a counter, so a system of N threads starts N - 1 workers.
+
+jobs are a function pointer plus a range, and finishing one decrements the counter it was submitted with. a job that depends on others
+waits on their counter, running other jobs in the meantime rather than blocking
+*/
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+struct JobCounter { //jobs submitted with this counter that haven't finished yet
+    std::atomic<int> Pending;
+
+    JobCounter() {
+        Pending.store(0);
+    }
+
+    bool isDone() {
+        return Pending.load(std::memory_order_acquire) == 0;
+    }
+};
+
+struct Job {
+    void (*Function)(void* data, size_t begin, size_t end);
+    void* Data;
+    size_t Begin;
+    size_t End;
+    JobCounter* Counter;
+};
+
+class WorkDeque { //Chase-Lev deque with a fixed capacity (push fails when full, the caller then runs the job itself)
+    static const int64_t Capacity = 4096; //power of 2
+
+    struct Slot { //a thief reads a slot while the owner may be refilling it, so every field is atomic (relaxed, Top/Bottom do the ordering)
+        std::atomic<void (*)(void*, size_t, size_t)> Function;
+        std::atomic<void*> Data;
+        std::atomic<size_t> Begin;
+        std::atomic<size_t> End;
+        std::atomic<JobCounter*> Counter;
+
+        void store(const Job& job) {
+            Function.store(job.Function, std::memory_order_relaxed);
+            Data.store(job.Data, std::memory_order_relaxed);
+            Begin.store(job.Begin, std::memory_order_relaxed);
+            End.store(job.End, std::memory_order_relaxed);
+            Counter.store(job.Counter, std::memory_order_relaxed);
+        }
+
+        Job load() {
+            return { Function.load(std::memory_order_relaxed), Data.load(std::memory_order_relaxed), Begin.load(std::memory_order_relaxed),
+                End.load(std::memory_order_relaxed), Counter.load(std::memory_order_relaxed) };
+        }
+    };
+
+    std::vector<Slot> Jobs;
+    std::atomic<int64_t> Top; //next to steal
+    std::atomic<int64_t> Bottom; //next free slot
+
+public:
+    WorkDeque() : Jobs(Capacity) {
+        Top.store(0);
+        Bottom.store(0);
+    }
+
+    bool push(const Job& job) { //owner only
+        int64_t bottom = Bottom.load(std::memory_order_relaxed);
+        int64_t top = Top.load(std::memory_order_acquire);
+        if (bottom - top >= Capacity) {
+            return false;
+        }
+        Jobs[bottom & (Capacity - 1)].store(job);
+        std::atomic_thread_fence(std::memory_order_release);
+        Bottom.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool pop(Job& job) { //owner only
+        int64_t bottom = Bottom.load(std::memory_order_relaxed) - 1;
+        Bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = Top.load(std::memory_order_relaxed);
+        if (top > bottom) { //empty
+            Bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        job = Jobs[bottom & (Capacity - 1)].load();
+        if (top != bottom) {
+            return true;
+        }
+        //last job, race any thief for it
+        bool won = Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        Bottom.store(bottom + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    bool steal(Job& job) { //any thread
+        int64_t top = Top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = Bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+        job = Jobs[top & (Capacity - 1)].load(); //only kept if the exchange below shows no one else took it first
+        return Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+};
+
+class JobSystem {
+    unsigned int ThreadCount;
+    std::thread::id OwnerThread;
+    std::vector<WorkDeque> Deques; //one per thread, [0] is the owner's
+    std::vector<std::thread> Workers;
+    std::atomic<bool> Stopping;
+    std::atomic<int> Queued; //jobs sitting in deques, lets sleeping workers know there's something to steal
+
+    std::mutex SleepMutex;
+    std::condition_variable WorkAvailable;
+    std::atomic<int> Sleeping;
+
+    static thread_local JobSystem* CurrentSystem; //system the calling thread works for, if it's a worker
+    static thread_local int CurrentIndex;
+
+public:
+    static const int RangesPerThread = 4; //parallelFor splits finer than one range per thread so stealing can even out uneven ranges
+    static const int SpinCount = 256; //failed attempts to find work before a worker sleeps
+
+    JobSystem(unsigned int thread_count = std::thread::hardware_concurrency()) : Deques(std::max(1u, thread_count)) {
+        ThreadCount = std::max(1u, thread_count);
+        OwnerThread = std::this_thread::get_id();
+        Stopping.store(false);
+        Queued.store(0);
+        Sleeping.store(0);
+        for (unsigned int i = 1; i < ThreadCount; i++) {
+            Workers.push_back(std::thread(&JobSystem::work, this, (int)i));
+        }
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(SleepMutex);
+            Stopping.store(true);
+        }
+        WorkAvailable.notify_all();
+        for (int i = 0; i < Workers.size(); i++) {
+            Workers[i].join();
+        }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    //shared system with a thread per core. first used on the main thread (see main), which becomes its owner
+    static JobSystem& getDefault() {
+        static JobSystem system;
+        return system;
+    }
+
+    unsigned int getThreadCount() {
+        return ThreadCount;
+    }
+
+    //queue function() to run on any thread, function must stay alive until counter is done.
+    //jobs can only be queued from the owner or worker threads, anywhere else they run immediately
+    template<typename F>
+    void run(F& function, JobCounter& counter) {
+        Job job = { &call<F>, &function, 0, 0, &counter };
+        submit(job);
+        wake();
+    }
+
+    //run until counter is done, running other jobs while waiting
+    void wait(JobCounter& counter) {
+        int index = getCurrentIndex();
+        Job job;
+        while (!counter.isDone()) {
+            if (index >= 0 && findJob(index, job)) {
+                execute(job);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    //kernel(begin, end) over [0, count) in ranges of at least min_range, returns once every range is done
+    template<typename Kernel>
+    void parallelFor(size_t count, size_t min_range, Kernel kernel) {
+        if (count == 0) {
+            return;
+        }
+        size_t range_count = std::min<size_t>((size_t)ThreadCount * RangesPerThread, count / std::max<size_t>(1, min_range));
+        if (range_count <= 1 || ThreadCount == 1 || getCurrentIndex() < 0) {
+            kernel((size_t)0, count);
+            return;
+        }
+        JobCounter counter;
+        for (size_t r = range_count - 1; r >= 1; r--) { //pushed in reverse so this thread pops them in order
+            Job job = { &callRange<Kernel>, &kernel, count * r / range_count, count * (r + 1) / range_count, &counter };
+            submit(job);
+        }
+        wake();
+        kernel((size_t)0, count / range_count);
+        wait(counter);
+    }
+
+private:
+    template<typename F>
+    static void call(void* data, size_t, size_t) {
+        (*(F*)data)();
+    }
+
+    template<typename Kernel>
+    static void callRange(void* data, size_t begin, size_t end) {
+        (*(Kernel*)data)(begin, end);
+    }
+
+    int getCurrentIndex() { //deque the calling thread owns, -1 if it doesn't belong to this system
+        if (CurrentSystem == this) {
+            return CurrentIndex;
+        }
+        return std::this_thread::get_id() == OwnerThread ? 0 : -1;
+    }
+
+    void submit(const Job& job) {
+        job.Counter->Pending.fetch_add(1, std::memory_order_relaxed);
+        int index = getCurrentIndex();
+        if (index >= 0 && Deques[index].push(job)) {
+            Queued.fetch_add(1, std::memory_order_release);
+        }
+        else {
+            execute(job);
+        }
+    }
+
+    void wake() {
+        if (Sleeping.load(std::memory_order_acquire) > 0) {
+            std::lock_guard<std::mutex> lock(SleepMutex);
+            WorkAvailable.notify_all();
+        }
+    }
+
+    bool findJob(int index, Job& job) { //own deque first, then steal round robin from the others
+        if (Deques[index].pop(job)) {
+            Queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        for (unsigned int i = 1; i < ThreadCount; i++) {
+            if (Deques[(index + i) % ThreadCount].steal(job)) {
+                Queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void execute(const Job& job) {
+        job.Function(job.Data, job.Begin, job.End);
+        job.Counter->Pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    void work(int index) {
+        CurrentSystem = this;
+        CurrentIndex = index;
+        int idle = 0;
+        Job job;
+        while (!Stopping.load(std::memory_order_relaxed)) {
+            if (findJob(index, job)) {
+                execute(job);
+                idle = 0;
+                continue;
+            }
+            if (++idle < SpinCount) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(SleepMutex);
+            Sleeping.fetch_add(1, std::memory_order_acq_rel);
+            WorkAvailable.wait_for(lock, std::chrono::milliseconds(1), [this]() { return Stopping.load() || Queued.load(std::memory_order_acquire) > 0; }); //timeout covers a wake racing the sleep
+            Sleeping.fetch_sub(1, std::memory_order_acq_rel);
+            idle = 0;
+        }
+    }
+};
+
+inline thread_local JobSystem* JobSystem::CurrentSystem = NULL;
+inline thread_local int JobSystem::CurrentIndex = -1;
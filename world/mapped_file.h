@@ -0,0 +1,150 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#undef near //windows.h defines these as empty macros, which breaks any parameter called near/far
+#undef far
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+class MappedFile { //read-only memory mapping of an entire file, pages are only read from disk as they are touched
+    const unsigned char* Data;
+    size_t Size;
+#ifdef _WIN32
+    HANDLE FileHandle;
+    HANDLE MappingHandle;
+#endif
+
+public:
+    MappedFile() {
+        reset();
+    }
+
+    MappedFile(std::string filename) {
+        reset();
+        open(filename);
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept {
+        reset();
+        *this = std::move(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            Data = other.Data;
+            Size = other.Size;
+#ifdef _WIN32
+            FileHandle = other.FileHandle;
+            MappingHandle = other.MappingHandle;
+#endif
+            other.reset();
+        }
+        return *this;
+    }
+
+    bool open(std::string filename) {
+        close();
+#ifdef _WIN32
+        FileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (FileHandle == INVALID_HANDLE_VALUE) {
+            FileHandle = NULL;
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(FileHandle, &file_size) || file_size.QuadPart == 0) { //empty files can't be mapped
+            close();
+            return false;
+        }
+        MappingHandle = CreateFileMappingA(FileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (MappingHandle == NULL) {
+            close();
+            return false;
+        }
+        Data = (const unsigned char*)MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0);
+        Size = (size_t)file_size.QuadPart;
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* mapping = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); //the mapping keeps its own reference to the file
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+        madvise(mapping, (size_t)file_stat.st_size, MADV_SEQUENTIAL);
+        Data = (const unsigned char*)mapping;
+        Size = (size_t)file_stat.st_size;
+#endif
+        if (Data == NULL) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (Data) {
+            UnmapViewOfFile(Data);
+        }
+        if (MappingHandle) {
+            CloseHandle(MappingHandle);
+        }
+        if (FileHandle) {
+            CloseHandle(FileHandle);
+        }
+#else
+        if (Data) {
+            munmap((void*)Data, Size);
+        }
+#endif
+        reset();
+    }
+
+    bool isOpen() const {
+        return Data != NULL;
+    }
+
+    const unsigned char* getData() const {
+        return Data;
+    }
+
+    size_t getSize() const {
+        return Size;
+    }
+
+private:
+    void reset() {
+        Data = NULL;
+        Size = 0;
+#ifdef _WIN32
+        FileHandle = NULL;
+        MappingHandle = NULL;
+#endif
+    }
+};
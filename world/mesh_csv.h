@@ -0,0 +1,168 @@
+#pragma once
+
+/*
+streaming parser for the csv mesh format:
+
+    x,y,z,u,v      (one vertex per line, floats may carry an "f" suffix)
+    ...
+                   (blank line)
+    i, j, k        (one triangle per line)
+    ...
+
+the buffer is walked once with numbers parsed in place (std::from_chars), nothing is allocated per line or per field,
+and large sections are split at line boundaries and parsed as parallel jobs
+*/
+
+#include <vector>
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+#include <glad/glad.h>
+
+#include "job_system.h"
+
+namespace MeshCSV {
+    const size_t MinChunkSize = 1 << 20; //below this a section isn't worth splitting across threads
+    const size_t ValuesPerVertex = 5; //x, y, z, u, v
+    const size_t ValuesPerTriangle = 3;
+
+    inline bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    //parse every comma separated value in [begin, end) into out, returns false on a malformed value (or anything but whitespace and
+    //a float's "f" suffix after one)
+    template<typename T>
+    bool parseSection(const char* begin, const char* end, std::vector<T>& out) {
+        const char* p = begin;
+        while (p < end) {
+            while (p < end && (isSpace(*p) || *p == '\n')) { //skip leading whitespace and empty lines
+                p++;
+            }
+            if (p == end) {
+                break;
+            }
+            if (*p == '+') { //from_chars doesn't accept an explicit plus sign
+                p++;
+            }
+
+            T value = 0;
+            std::from_chars_result result = std::from_chars(p, end, value);
+            if (result.ec != std::errc()) {
+                return false;
+            }
+            out.push_back(value);
+
+            p = result.ptr;
+            if (std::is_floating_point<T>::value && p < end && (*p == 'f' || *p == 'F')) {
+                p++;
+            }
+            while (p < end && isSpace(*p)) {
+                p++;
+            }
+            if (p < end && *p != ',' && *p != '\n') {
+                return false;
+            }
+            if (p < end && *p == ',') {
+                p++;
+            }
+        }
+        return true;
+    }
+
+    //estimate how many values a section holds from the density of separators in its first few KB, so output can be reserved up front
+    inline size_t estimateValueCount(const char* begin, const char* end) {
+        size_t sample_size = std::min<size_t>(end - begin, 4096);
+        size_t separators = 1;
+        for (size_t i = 0; i < sample_size; i++) {
+            separators += begin[i] == ',' || begin[i] == '\n';
+        }
+        return (size_t)(end - begin) * separators / std::max<size_t>(1, sample_size) * 5 / 4 + 16; //25% headroom for lines with longer numbers
+    }
+
+    //parse a section as up to one chunk per job system thread, each chunk is whole lines parsed into its own buffer, then they're concatenated in order
+    template<typename T>
+    bool parseSectionParallel(const char* begin, const char* end, std::vector<T>& out, JobSystem& jobs) {
+        size_t size = end - begin;
+        size_t chunk_count = std::max<size_t>(1, std::min<size_t>(jobs.getThreadCount(), size / MinChunkSize));
+
+        out.clear();
+        if (chunk_count == 1) {
+            out.reserve(estimateValueCount(begin, end));
+            return parseSection(begin, end, out);
+        }
+
+        //split at line boundaries
+        std::vector<const char*> bounds = { begin };
+        for (size_t i = 1; i < chunk_count; i++) {
+            const char* split = std::max(begin + size * i / chunk_count, bounds.back());
+            const char* newline = (const char*)memchr(split, '\n', end - split);
+            bounds.push_back(newline ? newline + 1 : end);
+        }
+        bounds.push_back(end);
+
+        std::vector<std::vector<T>> chunks(chunk_count);
+        std::vector<char> chunk_ok(chunk_count, 1);
+        jobs.parallelFor(chunk_count, 1, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                chunks[i].reserve(estimateValueCount(bounds[i], bounds[i + 1]));
+                chunk_ok[i] = parseSection(bounds[i], bounds[i + 1], chunks[i]);
+            }
+        });
+
+        size_t total = 0;
+        for (size_t i = 0; i < chunk_count; i++) {
+            if (!chunk_ok[i]) {
+                return false;
+            }
+            total += chunks[i].size();
+        }
+        out.resize(total);
+        size_t offset = 0;
+        for (size_t i = 0; i < chunk_count; i++) {
+            if (!chunks[i].empty()) {
+                memcpy(out.data() + offset, chunks[i].data(), chunks[i].size() * sizeof(T));
+            }
+            offset += chunks[i].size();
+        }
+        return true;
+    }
+
+    //find the blank line separating vertices from indices, returns end if there isn't one
+    inline const char* findSectionBreak(const char* begin, const char* end, const char*& indices_begin) {
+        const char* p = begin;
+        while ((p = (const char*)memchr(p, '\n', end - p)) != NULL) {
+            const char* line = p + 1;
+            const char* q = line;
+            while (q < end && isSpace(*q)) {
+                q++;
+            }
+            if (q == end || *q == '\n') { //blank (or whitespace only) line
+                indices_begin = q == end ? end : q + 1;
+                return p;
+            }
+            p = line;
+        }
+        indices_begin = end;
+        return end;
+    }
+
+    inline bool parse(const char* data, size_t size, std::vector<GLfloat>& vertices, std::vector<GLint>& indices, JobSystem& jobs = JobSystem::getDefault()) {
+        const char* end = data + size;
+        const char* indices_begin;
+        const char* vertices_end = findSectionBreak(data, end, indices_begin);
+
+        //both sections at once, each also split into chunks
+        bool indices_ok = true;
+        auto parse_indices = [&]() {
+            indices_ok = parseSectionParallel(indices_begin, end, indices, jobs);
+        };
+        JobCounter indices_done;
+        jobs.run(parse_indices, indices_done);
+        bool vertices_ok = parseSectionParallel(data, vertices_end, vertices, jobs);
+        jobs.wait(indices_done);
+        return vertices_ok && indices_ok && vertices.size() % ValuesPerVertex == 0 && indices.size() % ValuesPerTriangle == 0; //no partial vertex or triangle
+    }
+}
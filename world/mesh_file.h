@@ -0,0 +1,186 @@
+#pragma once
+
+/*
+binary mesh container (.mesh), laid out so the vertex and index blobs can be handed straight to glBufferData from a memory mapping:
+
+    Header                                (including the Dequantization undoing quantized attributes, see vertex_format.h)
+    AttributeDesc[Header.AttributeCount]  (vertex layout descriptor)
+    padding up to BlobAlignment
+    vertex blob                           (Header.VertexCount * Header.VertexStride bytes)
+    padding up to BlobAlignment
+    index blob                            (Header.IndexCount * size of Header.IndexType bytes)
+
+all values are little-endian, offsets are from the start of the file
+*/
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+
+#include <glad/glad.h>
+
+namespace MeshFile {
+    const uint32_t Magic = 0x48534D57; //"WMSH"
+    const uint32_t Version = 2; //2 added Dequantization
+    const uint64_t BlobAlignment = 64; //cache line (and comfortably above any GL alignment requirement)
+    const std::string Extension = ".mesh";
+
+    enum Semantic : uint32_t {
+        SemanticPosition = 0,
+        SemanticTexCoord = 1,
+        SemanticCount, //semantics double as attribute locations, the ones after are taken by instance attributes
+    };
+
+    struct AttributeDesc {
+        uint32_t Semantic; //what the attribute represents (maps onto a shader input name)
+        uint32_t Components; //1-4
+        uint32_t Type; //GLenum component type, e.g. GL_FLOAT
+        uint32_t Normalized; //GL_TRUE if integer components are normalized to [0, 1] / [-1, 1]
+        uint32_t Offset; //byte offset within a vertex
+    };
+
+    struct Dequantization { //decoded = bias + scale * stored (after normalizing), per component
+        float PositionScale[3];
+        float PositionBias[3];
+        float TexCoordScale[2];
+        float TexCoordBias[2];
+    };
+
+    struct Header {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t AttributeCount;
+        uint32_t VertexStride; //bytes per vertex
+        uint32_t IndexType; //GLenum, GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+        uint32_t Reserved;
+        uint64_t VertexCount;
+        uint64_t IndexCount;
+        uint64_t VertexOffset;
+        uint64_t IndexOffset;
+        Dequantization Dequantize;
+    };
+
+    inline Dequantization getIdentityDequantization() {
+        return { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 0.0f } };
+    }
+
+    inline uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    inline uint32_t getIndexSize(uint32_t index_type) {
+        return index_type == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+
+    inline const char* getSemanticName(uint32_t semantic) { //name of the matching vertex shader input
+        switch (semantic) {
+        case SemanticPosition: return "in_position";
+        case SemanticTexCoord: return "in_tex_coord";
+        }
+        return "";
+    }
+
+    inline bool hasExtension(std::string filename) {
+        return filename.size() >= Extension.size() && filename.compare(filename.size() - Extension.size(), Extension.size(), Extension) == 0;
+    }
+
+    //layout of the csv mesh format: 3 position floats followed by 2 texture coordinate floats
+    inline std::vector<AttributeDesc> getCSVLayout() {
+        return {
+            { SemanticPosition, 3, GL_FLOAT, GL_FALSE, 0 },
+            { SemanticTexCoord, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat) },
+        };
+    }
+
+    //true if every index is below vertex_count. reads every index, so it's run where mesh files are written and packed rather than
+    //on every load (loaders index per vertex arrays with these)
+    inline bool checkIndices(uint32_t index_type, const void* index_data, uint64_t index_count, uint64_t vertex_count) {
+        for (uint64_t i = 0; i < index_count; i++) {
+            uint64_t index = index_type == GL_UNSIGNED_SHORT ? ((const uint16_t*)index_data)[i] : ((const uint32_t*)index_data)[i];
+            if (index >= vertex_count) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //returns the header if data holds a well-formed mesh file (blobs inside data, only known semantics), NULL otherwise. only the header
+    //and layout are read, index values are left to checkIndices()
+    inline const Header* validate(const unsigned char* data, size_t size) {
+        if (data == NULL || size < sizeof(Header)) {
+            return NULL;
+        }
+        const Header* header = (const Header*)data;
+        if (header->Magic != Magic || header->Version != Version) {
+            return NULL;
+        }
+        //counts come from the file, so blob sizes are only multiplied out once they're known to fit (a crafted count could wrap past the checks)
+        uint64_t attributes_end = sizeof(Header) + (uint64_t)header->AttributeCount * sizeof(AttributeDesc);
+        if (attributes_end > size || header->VertexOffset < attributes_end || header->VertexOffset > size || header->VertexStride == 0
+            || header->VertexCount > (size - header->VertexOffset) / header->VertexStride) {
+            return NULL;
+        }
+        uint64_t vertex_end = header->VertexOffset + header->VertexCount * header->VertexStride;
+        if (header->IndexOffset < vertex_end || header->IndexOffset > size || header->IndexCount > (size - header->IndexOffset) / getIndexSize(header->IndexType)) {
+            return NULL;
+        }
+        if ((header->IndexType != GL_UNSIGNED_SHORT && header->IndexType != GL_UNSIGNED_INT) || header->IndexOffset % getIndexSize(header->IndexType) != 0) {
+            return NULL;
+        }
+        const AttributeDesc* attributes = (const AttributeDesc*)(header + 1);
+        for (uint32_t i = 0; i < header->AttributeCount; i++) {
+            if (attributes[i].Semantic >= SemanticCount || attributes[i].Components < 1 || attributes[i].Components > 4 || attributes[i].Offset >= header->VertexStride) {
+                return NULL;
+            }
+        }
+        return header;
+    }
+
+    //true if filename starts with a header this version can read, so stale converted files get rebuilt
+    inline bool isCurrent(std::string filename) {
+        Header header = {};
+        std::ifstream file(filename, std::ios::binary);
+        return file.read((char*)&header, sizeof(Header)) && header.Magic == Magic && header.Version == Version;
+    }
+
+    inline const AttributeDesc* getAttributes(const Header* header) {
+        return (const AttributeDesc*)(header + 1);
+    }
+
+    inline bool write(std::string filename, const std::vector<AttributeDesc>& layout, uint32_t vertex_stride, const void* vertex_data, uint64_t vertex_count, uint32_t index_type, const void* index_data, uint64_t index_count,
+        const Dequantization& dequantize = getIdentityDequantization()) {
+        if (!checkIndices(index_type, index_data, index_count, vertex_count)) {
+            return false; //nothing written, out of range indices never make it into a file
+        }
+        Header header = {};
+        header.Magic = Magic;
+        header.Version = Version;
+        header.AttributeCount = (uint32_t)layout.size();
+        header.VertexStride = vertex_stride;
+        header.IndexType = index_type;
+        header.VertexCount = vertex_count;
+        header.IndexCount = index_count;
+        header.VertexOffset = alignUp(sizeof(Header) + layout.size() * sizeof(AttributeDesc), BlobAlignment);
+        header.IndexOffset = alignUp(header.VertexOffset + vertex_count * vertex_stride, BlobAlignment);
+        header.Dequantize = dequantize;
+
+        uint64_t file_size = header.IndexOffset + index_count * getIndexSize(index_type);
+        std::vector<unsigned char> file_data(file_size, 0); //assembled in memory so the file is written with a single call
+        memcpy(file_data.data(), &header, sizeof(Header));
+        if (!layout.empty()) {
+            memcpy(file_data.data() + sizeof(Header), layout.data(), layout.size() * sizeof(AttributeDesc));
+        }
+        if (vertex_count > 0) {
+            memcpy(file_data.data() + header.VertexOffset, vertex_data, vertex_count * vertex_stride);
+        }
+        if (index_count > 0) {
+            memcpy(file_data.data() + header.IndexOffset, index_data, index_count * getIndexSize(index_type));
+        }
+
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        file.write((const char*)file_data.data(), file_data.size());
+        return (bool)file;
+    }
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+/*
+import time mesh optimization, for indexed triangle lists with any vertex layout (vertices are compared and moved as raw bytes):
+
+    deduplicateVertices()   identical vertices merged, so shared corners are transformed once
+    optimizeVertexCache()   triangles reordered so recently transformed vertices are reused (Forsyth's linear-speed vertex cache optimisation)
+    optimizeVertexFetch()   vertices reordered into the order the index buffer first reads them, so fetches walk memory forwards
+
+then indices can be stored as GL_UNSIGNED_SHORT whenever there are few enough vertices
+*/
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include <glad/glad.h>
+
+namespace MeshOptimizer {
+    const int CacheSize = 32; //modelled LRU cache size the triangle order is optimized for
+    const int FIFOCacheSize = 16; //fixed function FIFO cache ACMR is measured against, a conservative stand-in for real hardware
+
+    struct Stats {
+        size_t VerticesBefore;
+        size_t VerticesAfter;
+        double ACMRBefore; //average cache misses (vertex shader invocations) per triangle, 0.5 is ideal for large regular grids and 3 the worst
+        double ACMRAfter;
+        GLenum IndexType;
+    };
+
+    inline uint64_t hashBytes(const unsigned char* data, size_t size) { //64 bit FNV-1a
+        uint64_t result = 14695981039346656037ull;
+        for (size_t i = 0; i < size; i++) {
+            result = (result ^ data[i]) * 1099511628211ull;
+        }
+        return result;
+    }
+
+    //merge byte-identical vertices, rewriting indices to match. vertices keep the order they're first seen in
+    inline void deduplicateVertices(std::vector<unsigned char>& vertices, size_t stride, std::vector<uint32_t>& indices) {
+        size_t vertex_count = vertices.size() / stride;
+        size_t table_size = 1;
+        while (table_size < vertex_count * 2) {
+            table_size *= 2;
+        }
+        std::vector<uint32_t> table(table_size, UINT32_MAX); //open addressing, holds indices into the deduplicated vertices
+        std::vector<uint32_t> remap(vertex_count);
+        std::vector<unsigned char> unique;
+        unique.reserve(vertices.size());
+        for (size_t i = 0; i < vertex_count; i++) {
+            const unsigned char* vertex = vertices.data() + i * stride;
+            size_t slot = (size_t)hashBytes(vertex, stride) & (table_size - 1);
+            while (table[slot] != UINT32_MAX && memcmp(unique.data() + (size_t)table[slot] * stride, vertex, stride) != 0) {
+                slot = (slot + 1) & (table_size - 1);
+            }
+            if (table[slot] == UINT32_MAX) {
+                table[slot] = (uint32_t)(unique.size() / stride);
+                unique.insert(unique.end(), vertex, vertex + stride);
+            }
+            remap[i] = table[slot];
+        }
+        for (size_t i = 0; i < indices.size(); i++) {
+            indices[i] = remap[indices[i]];
+        }
+        vertices.swap(unique);
+    }
+
+    //vertex shader invocations per triangle through a FIFO post-transform cache
+    inline double computeACMR(const std::vector<uint32_t>& indices, size_t vertex_count, int cache_size = FIFOCacheSize) {
+        if (indices.size() < 3) {
+            return 0.0;
+        }
+        std::vector<uint32_t> entered(vertex_count, 0); //misses count when each vertex last entered the cache, 0 if never
+        uint32_t misses = 0;
+        for (size_t i = 0; i < indices.size(); i++) {
+            uint32_t index = indices[i];
+            if (entered[index] == 0 || misses - entered[index] >= (uint32_t)cache_size) {
+                misses++;
+                entered[index] = misses;
+            }
+        }
+        return (double)misses / (indices.size() / 3);
+    }
+
+    inline float scoreVertex(int cache_position, int remaining_triangles) {
+        if (remaining_triangles == 0) {
+            return -1.0f; //nothing left to draw with it
+        }
+        float score = 0.0f;
+        if (cache_position >= 0) {
+            if (cache_position < 3) {
+                score = 0.75f; //used by the last triangle, fixed score so the next one doesn't just strip along
+            }
+            else {
+                score = powf(1.0f - (float)(cache_position - 3) / (CacheSize - 3), 1.5f);
+            }
+        }
+        return score + 2.0f / sqrtf((float)remaining_triangles); //favour finishing off vertices with few triangles left, so they don't linger
+    }
+
+    //greedily emit the triangle whose vertices score highest against a modelled LRU cache. linear in triangle count
+    inline void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count) {
+        size_t triangle_count = indices.size() / 3;
+        if (triangle_count == 0) {
+            return;
+        }
+
+        //triangles using each vertex, as one flat array
+        std::vector<uint32_t> remaining(vertex_count, 0);
+        for (size_t i = 0; i < triangle_count * 3; i++) {
+            remaining[indices[i]]++;
+        }
+        std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+        for (size_t v = 0; v < vertex_count; v++) {
+            adjacency_offsets[v + 1] = adjacency_offsets[v] + remaining[v];
+        }
+        std::vector<uint32_t> adjacency(triangle_count * 3);
+        std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t t = 0; t < triangle_count; t++) {
+            for (int k = 0; k < 3; k++) {
+                adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+            }
+        }
+
+        std::vector<int> cache_positions(vertex_count, -1);
+        std::vector<float> vertex_scores(vertex_count);
+        for (size_t v = 0; v < vertex_count; v++) {
+            vertex_scores[v] = scoreVertex(-1, remaining[v]);
+        }
+        std::vector<float> triangle_scores(triangle_count);
+        std::vector<bool> emitted(triangle_count, false);
+        for (size_t t = 0; t < triangle_count; t++) {
+            triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+        }
+
+        std::vector<uint32_t> output;
+        output.reserve(triangle_count * 3);
+        std::vector<uint32_t> cache; //most recent first, CacheSize + 3 while a triangle is being added
+        std::vector<uint32_t> next_cache;
+        cache.reserve(CacheSize + 3);
+        next_cache.reserve(CacheSize + 3);
+        size_t scan = 0; //every triangle before this has been emitted, for when nothing in the cache has triangles left
+        int64_t best = -1;
+
+        for (size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++) {
+            if (best < 0) {
+                while (emitted[scan]) {
+                    scan++;
+                }
+                best = (int64_t)scan;
+            }
+            uint32_t triangle[3] = { indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2] };
+            output.insert(output.end(), triangle, triangle + 3);
+            emitted[best] = true;
+
+            //take the triangle out of its vertices' adjacency lists
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = triangle[k];
+                uint32_t* list = adjacency.data() + adjacency_offsets[v];
+                for (uint32_t a = 0; a < remaining[v]; a++) {
+                    if (list[a] == (uint32_t)best) {
+                        list[a] = list[remaining[v] - 1];
+                        break;
+                    }
+                }
+                remaining[v]--;
+            }
+
+            //move its vertices to the front of the cache
+            next_cache.assign(triangle, triangle + 3);
+            for (size_t c = 0; c < cache.size(); c++) {
+                if (cache[c] != triangle[0] && cache[c] != triangle[1] && cache[c] != triangle[2]) {
+                    next_cache.push_back(cache[c]);
+                }
+            }
+            cache.swap(next_cache);
+
+            //rescore everything in (or just pushed out of) the cache, then pick the best triangle touching it
+            best = -1;
+            float best_score = -1.0f;
+            for (size_t c = 0; c < cache.size(); c++) {
+                uint32_t v = cache[c];
+                cache_positions[v] = c < CacheSize ? (int)c : -1;
+                float score = scoreVertex(cache_positions[v], remaining[v]);
+                float delta = score - vertex_scores[v];
+                vertex_scores[v] = score;
+                const uint32_t* list = adjacency.data() + adjacency_offsets[v];
+                for (uint32_t a = 0; a < remaining[v]; a++) {
+                    triangle_scores[list[a]] += delta;
+                }
+            }
+            for (size_t c = 0; c < std::min(cache.size(), (size_t)CacheSize); c++) {
+                uint32_t v = cache[c];
+                const uint32_t* list = adjacency.data() + adjacency_offsets[v];
+                for (uint32_t a = 0; a < remaining[v]; a++) {
+                    if (triangle_scores[list[a]] > best_score) {
+                        best_score = triangle_scores[list[a]];
+                        best = list[a];
+                    }
+                }
+            }
+            if (cache.size() > CacheSize) {
+                cache.resize(CacheSize);
+            }
+        }
+        indices.swap(output);
+    }
+
+    //reorder vertices into first use order (dropping any never used), rewriting indices to match
+    inline void optimizeVertexFetch(std::vector<unsigned char>& vertices, size_t stride, std::vector<uint32_t>& indices) {
+        size_t vertex_count = vertices.size() / stride;
+        std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+        std::vector<unsigned char> ordered;
+        ordered.reserve(vertices.size());
+        uint32_t next = 0;
+        for (size_t i = 0; i < indices.size(); i++) {
+            uint32_t& target = remap[indices[i]];
+            if (target == UINT32_MAX) {
+                target = next++;
+                const unsigned char* vertex = vertices.data() + (size_t)indices[i] * stride;
+                ordered.insert(ordered.end(), vertex, vertex + stride);
+            }
+            indices[i] = target;
+        }
+        vertices.swap(ordered);
+    }
+
+    //every step above, returning before and after figures. indices must be a triangle list
+    inline Stats optimize(std::vector<unsigned char>& vertices, size_t stride, std::vector<uint32_t>& indices) {
+        Stats stats = {};
+        stats.VerticesBefore = vertices.size() / stride;
+        stats.ACMRBefore = computeACMR(indices, stats.VerticesBefore);
+
+        deduplicateVertices(vertices, stride, indices);
+        optimizeVertexCache(indices, vertices.size() / stride);
+        optimizeVertexFetch(vertices, stride, indices);
+
+        stats.VerticesAfter = vertices.size() / stride;
+        stats.ACMRAfter = computeACMR(indices, stats.VerticesAfter);
+        stats.IndexType = stats.VerticesAfter <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        return stats;
+    }
+
+    //indices in the given type's layout, ready to upload
+    inline std::vector<unsigned char> packIndices(const std::vector<uint32_t>& indices, GLenum index_type) {
+        std::vector<unsigned char> packed;
+        if (index_type == GL_UNSIGNED_SHORT) {
+            packed.resize(indices.size() * sizeof(uint16_t));
+            uint16_t* out = (uint16_t*)packed.data();
+            for (size_t i = 0; i < indices.size(); i++) {
+                out[i] = (uint16_t)indices[i];
+            }
+        }
+        else {
+            packed.resize(indices.size() * sizeof(uint32_t));
+            memcpy(packed.data(), indices.data(), packed.size());
+        }
+        return packed;
+    }
+}
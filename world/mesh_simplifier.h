@@ -0,0 +1,260 @@
+#pragma once
+
+/*
+quadric error metric simplification (Garland & Heckbert) by edge collapse, for building LOD chains at load time.
+every vertex accumulates the planes of the triangles around it, and collapsing an edge costs the mean squared distance of the surviving
+vertex from all the planes merged into it. collapses only move a vertex onto one of its neighbours, so simplified meshes reuse the
+original vertex buffer and only need new indices.
+
+vertices sharing a position with another vertex (uv seams, hard edges) and vertices on open borders are locked, so seams and
+silhouettes keep their exact shape
+*/
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include <glm.hpp>
+
+namespace MeshSimplifier {
+    struct Quadric { //sum of w * (n.p + d)^2 over planes, as the upper triangle of a symmetric 4x4 matrix
+        double A2, AB, AC, AD, B2, BC, BD, C2, CD, D2;
+        double Weight;
+    };
+
+    struct Level { //one LOD's slice of a combined index buffer
+        size_t IndexOffset; //in indices
+        size_t IndexCount;
+        float Error; //object space distance the level may deviate from the full mesh by
+    };
+
+    inline void addPlane(Quadric& q, glm::vec3 normal, float d, double weight) {
+        double a = normal.x, b = normal.y, c = normal.z;
+        q.A2 += weight * a * a; q.AB += weight * a * b; q.AC += weight * a * c; q.AD += weight * a * d;
+        q.B2 += weight * b * b; q.BC += weight * b * c; q.BD += weight * b * d;
+        q.C2 += weight * c * c; q.CD += weight * c * d;
+        q.D2 += weight * d * d;
+        q.Weight += weight;
+    }
+
+    inline void addQuadric(Quadric& q, const Quadric& other) {
+        q.A2 += other.A2; q.AB += other.AB; q.AC += other.AC; q.AD += other.AD;
+        q.B2 += other.B2; q.BC += other.BC; q.BD += other.BD;
+        q.C2 += other.C2; q.CD += other.CD;
+        q.D2 += other.D2;
+        q.Weight += other.Weight;
+    }
+
+    inline double evaluate(const Quadric& q, glm::vec3 p) { //weighted sum of squared distances to the planes
+        double x = p.x, y = p.y, z = p.z;
+        double result = q.A2 * x * x + q.B2 * y * y + q.C2 * z * z + q.D2
+            + 2.0 * (q.AB * x * y + q.AC * x * z + q.BC * y * z + q.AD * x + q.BD * y + q.CD * z);
+        return std::max(0.0, result);
+    }
+
+    inline uint64_t hashPosition(glm::vec3 p) {
+        uint32_t bits[3];
+        memcpy(bits, &p.x, sizeof(float));
+        memcpy(bits + 1, &p.y, sizeof(float));
+        memcpy(bits + 2, &p.z, sizeof(float));
+        return ((uint64_t)bits[0] * 73856093u) ^ ((uint64_t)bits[1] * 19349663u) ^ ((uint64_t)bits[2] * 83492791u);
+    }
+
+    inline bool flips(const std::vector<glm::vec3>& positions, const uint32_t* triangle, uint32_t from, uint32_t to) { //would moving from onto to turn this triangle over (or flatten it)
+        glm::vec3 before[3];
+        glm::vec3 after[3];
+        for (int k = 0; k < 3; k++) {
+            before[k] = positions[triangle[k]];
+            after[k] = triangle[k] == from ? positions[to] : before[k];
+        }
+        glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+        return glm::dot(normal_before, normal_after) <= 0.0f;
+    }
+
+    //indices of a simplified version of a triangle list, with at most target_index_count indices if that's reachable without any vertex
+    //moving further than max_error from the original surface. error (if given) is set to the largest deviation actually introduced
+    inline std::vector<uint32_t> simplify(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, size_t target_index_count, float max_error, float* error = NULL) {
+        size_t vertex_count = positions.size();
+        std::vector<uint32_t> result = indices;
+        double max_error2 = (double)max_error * max_error;
+        double worst_error2 = 0.0;
+
+        //lock vertices sharing a position (seams) and on borders (position space edges used by only one triangle)
+        std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+        std::vector<uint32_t> canonical(vertex_count);
+        std::vector<bool> locked(vertex_count, false);
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            std::vector<uint32_t>& bucket = buckets[hashPosition(positions[v])];
+            canonical[v] = v;
+            for (uint32_t other : bucket) {
+                if (positions[other] == positions[v]) {
+                    canonical[v] = canonical[other];
+                    locked[v] = true;
+                    locked[other] = true;
+                    break;
+                }
+            }
+            bucket.push_back(v);
+        }
+        std::unordered_map<uint64_t, int> edge_uses;
+        for (size_t i = 0; i + 2 < result.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = canonical[result[i + k]];
+                uint32_t b = canonical[result[i + (k + 1) % 3]];
+                edge_uses[(uint64_t)std::min(a, b) << 32 | std::max(a, b)]++;
+            }
+        }
+        std::vector<bool> border(vertex_count, false);
+        for (auto& edge : edge_uses) {
+            if (edge.second == 1) {
+                border[edge.first >> 32] = true;
+                border[edge.first & 0xFFFFFFFF] = true;
+            }
+        }
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            locked[v] = locked[v] || border[canonical[v]];
+        }
+
+        //area weighted plane quadrics
+        std::vector<Quadric> quadrics(vertex_count, Quadric());
+        for (size_t i = 0; i + 2 < result.size(); i += 3) {
+            glm::vec3 p0 = positions[result[i]];
+            glm::vec3 normal = glm::cross(positions[result[i + 1]] - p0, positions[result[i + 2]] - p0);
+            float length = glm::length(normal);
+            if (length == 0.0f) {
+                continue;
+            }
+            normal = normal / length;
+            for (int k = 0; k < 3; k++) {
+                addPlane(quadrics[result[i + k]], normal, -glm::dot(normal, p0), length * 0.5);
+            }
+        }
+
+        struct Collapse {
+            uint32_t From;
+            uint32_t To;
+            double Error; //mean squared distance
+        };
+        std::vector<Collapse> collapses;
+        std::vector<uint32_t> adjacency_offsets;
+        std::vector<uint32_t> adjacency;
+        std::vector<bool> touched;
+        std::vector<uint32_t> remap;
+
+        //passes of independent collapses, cheapest first, each pass aiming to remove the remaining excess triangles
+        while (result.size() > target_index_count) {
+            collapses.clear();
+            for (size_t i = 0; i + 2 < result.size(); i += 3) {
+                for (int k = 0; k < 3; k++) {
+                    uint32_t a = result[i + k];
+                    uint32_t b = result[i + (k + 1) % 3];
+                    if (a > b) {
+                        continue; //the same edge in the neighbouring triangle is taken the other way round
+                    }
+                    Quadric merged = quadrics[a];
+                    addQuadric(merged, quadrics[b]);
+                    double weight = std::max(merged.Weight, 1e-12);
+                    double to_b = locked[a] ? INFINITY : evaluate(merged, positions[b]) / weight;
+                    double to_a = locked[b] ? INFINITY : evaluate(merged, positions[a]) / weight;
+                    if (to_b != INFINITY || to_a != INFINITY) {
+                        collapses.push_back(to_b <= to_a ? Collapse{ a, b, to_b } : Collapse{ b, a, to_a });
+                    }
+                }
+            }
+            if (collapses.empty()) {
+                break;
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.Error < y.Error; });
+
+            adjacency_offsets.assign(vertex_count + 1, 0);
+            for (size_t i = 0; i < result.size(); i++) {
+                adjacency_offsets[result[i] + 1]++;
+            }
+            for (size_t v = 0; v < vertex_count; v++) {
+                adjacency_offsets[v + 1] += adjacency_offsets[v];
+            }
+            adjacency.resize(result.size());
+            std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) {
+                adjacency[fill[result[i]]++] = (uint32_t)(i / 3);
+            }
+
+            touched.assign(vertex_count, false);
+            remap.resize(vertex_count);
+            for (uint32_t v = 0; v < vertex_count; v++) {
+                remap[v] = v;
+            }
+            size_t goal = (result.size() - target_index_count) / 3 / 2 + 1; //an interior collapse removes 2 triangles
+            size_t collapsed = 0;
+            for (const Collapse& collapse : collapses) {
+                if (collapse.Error > max_error2 || collapsed >= goal) {
+                    break;
+                }
+                if (touched[collapse.From] || touched[collapse.To]) {
+                    continue;
+                }
+                bool flipped = false;
+                for (uint32_t a = adjacency_offsets[collapse.From]; a < adjacency_offsets[collapse.From + 1] && !flipped; a++) {
+                    const uint32_t* triangle = &result[adjacency[a] * 3];
+                    if (triangle[0] != collapse.To && triangle[1] != collapse.To && triangle[2] != collapse.To) {
+                        flipped = flips(positions, triangle, collapse.From, collapse.To);
+                    }
+                }
+                if (flipped) {
+                    continue;
+                }
+                //nothing else around this collapse moves this pass, so the flip test above stays valid
+                for (uint32_t a = adjacency_offsets[collapse.From]; a < adjacency_offsets[collapse.From + 1]; a++) {
+                    const uint32_t* triangle = &result[adjacency[a] * 3];
+                    touched[triangle[0]] = true;
+                    touched[triangle[1]] = true;
+                    touched[triangle[2]] = true;
+                }
+                remap[collapse.From] = collapse.To;
+                addQuadric(quadrics[collapse.To], quadrics[collapse.From]);
+                worst_error2 = std::max(worst_error2, collapse.Error);
+                collapsed++;
+            }
+            if (collapsed == 0) {
+                break;
+            }
+
+            size_t write = 0;
+            for (size_t i = 0; i + 2 < result.size(); i += 3) {
+                uint32_t a = remap[result[i]];
+                uint32_t b = remap[result[i + 1]];
+                uint32_t c = remap[result[i + 2]];
+                if (a != b && b != c && c != a) {
+                    result[write++] = a;
+                    result[write++] = b;
+                    result[write++] = c;
+                }
+            }
+            result.resize(write);
+        }
+
+        if (error) {
+            *error = (float)sqrt(worst_error2);
+        }
+        return result;
+    }
+
+    //coarsest level whose error projects to under threshold pixels. errors must grow with the level, pixels_per_unit is the screen
+    //size of one unit at distance 1. a level only becomes coarser once it's hysteresis (fraction) under the threshold, so objects
+    //sitting at a switching distance don't flicker between levels
+    inline int selectLevel(const Level* levels, int level_count, int current, float distance, float pixels_per_unit, float threshold, float hysteresis) {
+        float scale = pixels_per_unit / std::max(distance, 1e-4f);
+        int level = std::min(current, level_count - 1);
+        while (level > 0 && levels[level].Error * scale > threshold) { //too coarse
+            level--;
+        }
+        while (level + 1 < level_count && levels[level + 1].Error * scale < threshold * (1.0f - hysteresis)) {
+            level++;
+        }
+        return level;
+    }
+}
@@ -0,0 +1,355 @@
+#pragma once
+
+/*
+software occlusion culling: a few large, nearby occluder meshes are rasterized on the cpu into a low resolution depth buffer, which
+is reduced into a pyramid of max depths (hierarchical z). an object is hidden if the nearest point of its bounding box is further
+away than the furthest occluder depth over the screen rectangle the box covers, read from the pyramid level where that rectangle is
+at most 2x2 texels, so every test costs the same whatever the object's size on screen.
+
+rasterization is split into horizontal bands run as jobs, each filling 4 pixels at a time with sse4.1 where the cpu has it, and
+tests then project a box's 8 corners 4 at a time. the 1 ms budget for a pass (BudgetMs) is for the sse4.1 path on one core, which
+every x86-64 cpu from the last decade has; the scalar path is only the fallback for older cpus and can go over it.
+occluders are rasterized double sided (closed meshes hide their own back faces anyway) and triangles crossing the near plane are
+skipped, both of which can only make the buffer less occluding, never wrongly hide something
+*/
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+#include <glm.hpp>
+
+#include "job_system.h"
+#include "transform_batch.h"
+
+class OcclusionBuffer {
+public:
+    static const int Width = 256; //multiple of 4 (sse) and of the top pyramid level
+    static const int Height = 128;
+    static const int BandHeight = 16; //rows per rasterization job
+    static constexpr double BudgetMs = 1.0; //rasterize + tests at sse4.1 on one core, see the top of the file
+
+    struct Stats {
+        int Occluders;
+        int Triangles; //rasterized, after dropping near plane crossings and degenerates
+    };
+
+    OcclusionBuffer() {
+        int width = Width;
+        int height = Height;
+        while (width >= 1 && height >= 1) {
+            Levels.push_back(std::vector<float>((size_t)width * height, 1.0f));
+            LevelWidths.push_back(width);
+            LevelHeights.push_back(height);
+            if (width == 1 || height == 1) {
+                break;
+            }
+            width /= 2;
+            height /= 2;
+        }
+        Counts = {};
+        KernelLevel = TransformBatch::LevelScalar;
+    }
+
+    //start a frame: clear to the far plane, later occluders and tests are projected by view_proj
+    void begin(const glm::mat4& view_proj) {
+        ViewProj = view_proj;
+        std::fill(Levels[0].begin(), Levels[0].end(), 1.0f);
+        Triangles.clear();
+        Counts = {};
+    }
+
+    //project an occluder's triangles to the screen, ready for rasterize()
+    void addOccluder(const glm::mat4& model, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices) {
+        glm::mat4 model_view_proj = ViewProj * model;
+        Projected.resize(positions.size());
+        for (size_t i = 0; i < positions.size(); i++) {
+            Projected[i] = model_view_proj * glm::vec4(positions[i], 1.0f);
+        }
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const glm::vec4* clip[3] = { &Projected[indices[i]], &Projected[indices[i + 1]], &Projected[indices[i + 2]] };
+            if (clip[0]->w <= NearW || clip[1]->w <= NearW || clip[2]->w <= NearW) {
+                continue;
+            }
+            ScreenTriangle triangle;
+            for (int k = 0; k < 3; k++) {
+                float inverse_w = 1.0f / clip[k]->w;
+                triangle.X[k] = (clip[k]->x * inverse_w * 0.5f + 0.5f) * Width;
+                triangle.Y[k] = (clip[k]->y * inverse_w * 0.5f + 0.5f) * Height;
+                triangle.Z[k] = clip[k]->z * inverse_w * 0.5f + 0.5f;
+            }
+            if (setup(triangle)) {
+                Triangles.push_back(triangle);
+            }
+        }
+        Counts.Occluders++;
+    }
+
+    //fill the depth buffer from every added occluder, then rebuild the pyramid. level also picks the kernel for later isVisible tests
+    void rasterize(JobSystem& jobs = JobSystem::getDefault(), TransformBatch::Level level = TransformBatch::detectLevel()) {
+        Counts.Triangles = (int)Triangles.size();
+        KernelLevel = level;
+        jobs.parallelFor(Height / BandHeight, 1, [&](size_t begin, size_t end) {
+            for (size_t band = begin; band < end; band++) {
+                rasterizeBand((int)band * BandHeight, (int)band * BandHeight + BandHeight, level);
+            }
+        });
+        for (size_t l = 1; l < Levels.size(); l++) { //each texel the furthest of the 4 below it
+            const std::vector<float>& below = Levels[l - 1];
+            int below_width = LevelWidths[l - 1];
+            for (int y = 0; y < LevelHeights[l]; y++) {
+                for (int x = 0; x < LevelWidths[l]; x++) {
+                    const float* texels = &below[(size_t)(y * 2) * below_width + x * 2];
+                    Levels[l][(size_t)y * LevelWidths[l] + x] = std::max(std::max(texels[0], texels[1]), std::max(texels[below_width], texels[below_width + 1]));
+                }
+            }
+        }
+    }
+
+    //false if the box is entirely behind occluders. boxes crossing the near plane are always visible. thread safe after rasterize()
+    bool isVisible(glm::vec3 min, glm::vec3 max) const {
+        glm::vec3 size = max - min;
+        glm::vec4 origin = ViewProj * glm::vec4(min, 1.0f); //corners as the min corner plus projected edges, 4 transforms instead of 8
+        glm::vec4 edges[3] = { ViewProj[0] * size.x, ViewProj[1] * size.y, ViewProj[2] * size.z };
+        float bounds[5];
+        bool in_front;
+#ifdef TRANSFORM_BATCH_X86
+        if (KernelLevel >= TransformBatch::LevelSSE41) {
+            in_front = projectBoxSSE41(origin, edges, bounds);
+        }
+        else
+#endif
+        in_front = projectBoxScalar(origin, edges, bounds);
+        if (!in_front) {
+            return true;
+        }
+        float min_x = bounds[0], min_y = bounds[1], max_x = bounds[2], max_y = bounds[3], nearest = bounds[4];
+        int x0 = std::max(0, (int)floorf(min_x));
+        int y0 = std::max(0, (int)floorf(min_y));
+        int x1 = std::min(Width - 1, (int)floorf(max_x));
+        int y1 = std::min(Height - 1, (int)floorf(max_y));
+        if (x0 > x1 || y0 > y1) {
+            return true; //off screen, that's for frustum culling to decide
+        }
+
+        int level = 0;
+        while (level + 1 < (int)Levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+            level++;
+        }
+        const std::vector<float>& depths = Levels[level];
+        for (int y = y0 >> level; y <= y1 >> level; y++) {
+            for (int x = x0 >> level; x <= x1 >> level; x++) {
+                if (nearest <= depths[(size_t)y * LevelWidths[level] + x]) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    Stats getStats() {
+        return Counts;
+    }
+
+    const float* getDepth() { //Width x Height, bottom row first, 0 near to 1 far
+        return Levels[0].data();
+    }
+
+private:
+    struct ScreenTriangle {
+        float X[3];
+        float Y[3];
+        float Z[3];
+        float EdgeA[3]; //edge functions a * x + b * y + c, positive inside
+        float EdgeB[3];
+        float EdgeC[3];
+        float DepthX; //depth plane z = DepthX * x + DepthY * y + DepthC
+        float DepthY;
+        float DepthC;
+        int MinX, MaxX, MinY, MaxY; //pixel bounds, clamped to the screen
+    };
+
+    static constexpr float NearW = 1e-4f; //clip w at or behind this is treated as crossing the near plane
+
+    glm::mat4 ViewProj;
+    std::vector<std::vector<float>> Levels; //[0] is the full resolution depth buffer
+    std::vector<int> LevelWidths;
+    std::vector<int> LevelHeights;
+    std::vector<ScreenTriangle> Triangles;
+    std::vector<glm::vec4> Projected; //scratch
+    Stats Counts;
+    TransformBatch::Level KernelLevel; //isVisible projects boxes with the level the last rasterize() used
+
+    static bool setup(ScreenTriangle& t) { //edge and depth equations, false if the triangle covers no pixels
+        float area = (t.X[1] - t.X[0]) * (t.Y[2] - t.Y[0]) - (t.X[2] - t.X[0]) * (t.Y[1] - t.Y[0]);
+        if (area == 0.0f) {
+            return false;
+        }
+        if (area < 0.0f) { //double sided, wind every triangle counter clockwise
+            std::swap(t.X[1], t.X[2]);
+            std::swap(t.Y[1], t.Y[2]);
+            std::swap(t.Z[1], t.Z[2]);
+            area = -area;
+        }
+        for (int k = 0; k < 3; k++) {
+            int next = (k + 1) % 3;
+            t.EdgeA[k] = t.Y[k] - t.Y[next];
+            t.EdgeB[k] = t.X[next] - t.X[k];
+            t.EdgeC[k] = t.X[k] * t.Y[next] - t.X[next] * t.Y[k];
+        }
+        t.DepthX = ((t.Z[1] - t.Z[0]) * (t.Y[2] - t.Y[0]) - (t.Z[2] - t.Z[0]) * (t.Y[1] - t.Y[0])) / area;
+        t.DepthY = ((t.Z[2] - t.Z[0]) * (t.X[1] - t.X[0]) - (t.Z[1] - t.Z[0]) * (t.X[2] - t.X[0])) / area;
+        t.DepthC = t.Z[0] - t.DepthX * t.X[0] - t.DepthY * t.Y[0];
+
+        //pixels whose centres (x + 0.5) could be inside
+        t.MinX = std::max(0, (int)ceilf(std::min(t.X[0], std::min(t.X[1], t.X[2])) - 0.5f));
+        t.MaxX = std::min(Width - 1, (int)floorf(std::max(t.X[0], std::max(t.X[1], t.X[2])) - 0.5f));
+        t.MinY = std::max(0, (int)ceilf(std::min(t.Y[0], std::min(t.Y[1], t.Y[2])) - 0.5f));
+        t.MaxY = std::min(Height - 1, (int)floorf(std::max(t.Y[0], std::max(t.Y[1], t.Y[2])) - 0.5f));
+        return t.MinX <= t.MaxX && t.MinY <= t.MaxY;
+    }
+
+    void rasterizeBand(int band_min_y, int band_end_y, TransformBatch::Level level) {
+#ifdef TRANSFORM_BATCH_X86
+        if (level >= TransformBatch::LevelSSE41) {
+            rasterizeBandSSE41(band_min_y, band_end_y);
+            return;
+        }
+#endif
+        float* depth = Levels[0].data();
+        for (const ScreenTriangle& t : Triangles) {
+            int min_y = std::max(t.MinY, band_min_y);
+            int max_y = std::min(t.MaxY, band_end_y - 1);
+            for (int y = min_y; y <= max_y; y++) {
+                rasterizeRowScalar(t, depth + (size_t)y * Width, y, t.MinX, t.MaxX);
+            }
+        }
+    }
+
+    static void rasterizeRowScalar(const ScreenTriangle& t, float* row, int y, int x, int max_x) {
+        float py = y + 0.5f;
+        for (; x <= max_x; x++) {
+            float px = x + 0.5f;
+            if (t.EdgeA[0] * px + t.EdgeB[0] * py + t.EdgeC[0] >= 0.0f && t.EdgeA[1] * px + t.EdgeB[1] * py + t.EdgeC[1] >= 0.0f && t.EdgeA[2] * px + t.EdgeB[2] * py + t.EdgeC[2] >= 0.0f) {
+                row[x] = std::min(row[x], t.DepthX * px + t.DepthY * py + t.DepthC);
+            }
+        }
+    }
+
+    //screen bounds of a box's 8 corners (min x, min y, max x, max y, nearest z), false if any corner crosses the near plane
+    static bool projectBoxScalar(const glm::vec4& origin, const glm::vec4* edges, float* bounds) {
+        bounds[0] = bounds[1] = bounds[4] = INFINITY;
+        bounds[2] = bounds[3] = -INFINITY;
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec4 clip = origin;
+            for (int axis = 0; axis < 3; axis++) {
+                if (corner & (1 << axis)) {
+                    clip += edges[axis];
+                }
+            }
+            if (clip.w <= NearW) {
+                return false;
+            }
+            float inverse_w = 1.0f / clip.w;
+            float x = (clip.x * inverse_w * 0.5f + 0.5f) * Width;
+            float y = (clip.y * inverse_w * 0.5f + 0.5f) * Height;
+            bounds[0] = std::min(bounds[0], x);
+            bounds[1] = std::min(bounds[1], y);
+            bounds[2] = std::max(bounds[2], x);
+            bounds[3] = std::max(bounds[3], y);
+            bounds[4] = std::min(bounds[4], clip.z * inverse_w * 0.5f + 0.5f);
+        }
+        return true;
+    }
+
+#ifdef TRANSFORM_BATCH_X86
+    //4 pixels at a time from the group holding MinX, lanes outside the triangle's bounds masked off so no scalar loop is left over.
+    //same arithmetic as the scalar loop (b * y is per row either way, x steps by exactly 4), so both paths produce identical buffers
+    TRANSFORM_BATCH_SSE41 void rasterizeBandSSE41(int band_min_y, int band_end_y) {
+        float* depth = Levels[0].data();
+        __m128 zero = _mm_setzero_ps();
+        __m128 four = _mm_set1_ps(4.0f);
+        __m128 lane_offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        for (const ScreenTriangle& t : Triangles) {
+            int min_y = std::max(t.MinY, band_min_y);
+            int max_y = std::min(t.MaxY, band_end_y - 1);
+            if (min_y > max_y) {
+                continue;
+            }
+            __m128 edge_a[3], edge_c[3];
+            for (int k = 0; k < 3; k++) {
+                edge_a[k] = _mm_set1_ps(t.EdgeA[k]);
+                edge_c[k] = _mm_set1_ps(t.EdgeC[k]);
+            }
+            __m128 depth_x = _mm_set1_ps(t.DepthX);
+            __m128 depth_c = _mm_set1_ps(t.DepthC);
+            __m128 first_px = _mm_set1_ps(t.MinX + 0.5f);
+            __m128 last_px = _mm_set1_ps(t.MaxX + 0.5f);
+            int start_x = t.MinX & ~3;
+            __m128 start_px = _mm_add_ps(_mm_set1_ps((float)start_x), lane_offsets);
+
+            for (int y = min_y; y <= max_y; y++) {
+                float py = y + 0.5f;
+                __m128 edge_by[3];
+                for (int k = 0; k < 3; k++) {
+                    edge_by[k] = _mm_set1_ps(t.EdgeB[k] * py);
+                }
+                __m128 depth_y = _mm_set1_ps(t.DepthY * py);
+                float* row = depth + (size_t)y * Width;
+                __m128 px = start_px;
+                for (int x = start_x; x <= t.MaxX; x += 4, px = _mm_add_ps(px, four)) {
+                    __m128 inside = _mm_and_ps(_mm_cmpge_ps(px, first_px), _mm_cmple_ps(px, last_px));
+                    for (int k = 0; k < 3; k++) {
+                        __m128 edge = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge_a[k], px), edge_by[k]), edge_c[k]);
+                        inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+                    }
+                    if (_mm_movemask_ps(inside) == 0) {
+                        continue;
+                    }
+                    __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(depth_x, px), depth_y), depth_c);
+                    __m128 old = _mm_loadu_ps(row + x);
+                    _mm_storeu_ps(row + x, _mm_blendv_ps(old, _mm_min_ps(old, z), inside));
+                }
+            }
+        }
+    }
+
+    //the 8 corners as two groups of 4 lanes (corners 0-3, then 4-7 with the z edge added), same operations in the same order as
+    //projectBoxScalar, adding 0 where the scalar loop skips an edge
+    TRANSFORM_BATCH_SSE41 static bool projectBoxSSE41(const glm::vec4& origin, const glm::vec4* edges, float* bounds) {
+        __m128 clip_low[4], clip_high[4];
+        for (int j = 0; j < 4; j++) {
+            __m128 clip = _mm_add_ps(_mm_set1_ps(origin[j]), _mm_set_ps(edges[0][j], 0.0f, edges[0][j], 0.0f));
+            clip_low[j] = _mm_add_ps(clip, _mm_set_ps(edges[1][j], edges[1][j], 0.0f, 0.0f));
+            clip_high[j] = _mm_add_ps(clip_low[j], _mm_set1_ps(edges[2][j]));
+        }
+        __m128 near_w = _mm_set1_ps(NearW);
+        if (_mm_movemask_ps(_mm_or_ps(_mm_cmple_ps(clip_low[3], near_w), _mm_cmple_ps(clip_high[3], near_w))) != 0) {
+            return false;
+        }
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 half = _mm_set1_ps(0.5f);
+        __m128 scales[3] = { _mm_set1_ps((float)Width), _mm_set1_ps((float)Height), one };
+        __m128 inverse_w_low = _mm_div_ps(one, clip_low[3]);
+        __m128 inverse_w_high = _mm_div_ps(one, clip_high[3]);
+        __m128 mins[3], maxs[3];
+        for (int j = 0; j < 3; j++) {
+            __m128 low = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(clip_low[j], inverse_w_low), half), half), scales[j]);
+            __m128 high = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(clip_high[j], inverse_w_high), half), half), scales[j]);
+            mins[j] = _mm_min_ps(low, high);
+            mins[j] = _mm_min_ps(mins[j], _mm_shuffle_ps(mins[j], mins[j], _MM_SHUFFLE(1, 0, 3, 2)));
+            mins[j] = _mm_min_ps(mins[j], _mm_shuffle_ps(mins[j], mins[j], _MM_SHUFFLE(2, 3, 0, 1)));
+            maxs[j] = _mm_max_ps(low, high);
+            maxs[j] = _mm_max_ps(maxs[j], _mm_shuffle_ps(maxs[j], maxs[j], _MM_SHUFFLE(1, 0, 3, 2)));
+            maxs[j] = _mm_max_ps(maxs[j], _mm_shuffle_ps(maxs[j], maxs[j], _MM_SHUFFLE(2, 3, 0, 1)));
+        }
+        bounds[0] = _mm_cvtss_f32(mins[0]);
+        bounds[1] = _mm_cvtss_f32(mins[1]);
+        bounds[2] = _mm_cvtss_f32(maxs[0]);
+        bounds[3] = _mm_cvtss_f32(maxs[1]);
+        bounds[4] = _mm_cvtss_f32(mins[2]);
+        return true;
+    }
+#endif
+};
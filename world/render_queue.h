@@ -0,0 +1,280 @@
+#pragma once
+
+/*
+draw submission in two halves: the frontend collects compact draw commands, each with a 64 bit sort key, and radix sorts them.
+the backend then walks them in key order through a cache of bound GL state, so consecutive draws sharing a program, textures or
+vertex array only bind them once:
+
+    bits 56-63  program      (most expensive to change, so the most significant)
+    bits 44-55  material     (set of textures)
+    bits 32-43  vertex array
+    bits  8-31  depth        (front to back, so early depth testing rejects hidden fragments)
+    bits  0-7   unused
+*/
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include <glm.hpp>
+#include <gtc/type_ptr.hpp>
+
+#include "shader_program.h"
+
+class GLStateCache { //binds only when the requested object differs from what's already bound, counting issued and skipped calls
+public:
+    static const int MaxTextureUnits = 4;
+
+    int Issued;
+    int Skipped;
+
+    GLStateCache() {
+        invalidate();
+        Issued = 0;
+        Skipped = 0;
+    }
+
+    //forget everything, for after code outside the cache has bound things (texture uploads, buffer mapping)
+    void invalidate() {
+        Program = -1;
+        VertexArray = -1;
+        ArrayBuffer = -1;
+        ActiveUnit = -1;
+        for (int i = 0; i < MaxTextureUnits; i++) {
+            Textures[i] = -1;
+        }
+        InstanceBuffer = -1;
+        InstanceOffset = -1;
+        InstanceLayersOffset = -1;
+    }
+
+    void resetCounts() {
+        Issued = 0;
+        Skipped = 0;
+    }
+
+    void useProgram(GLuint program) {
+        if (check(Program, program)) {
+            glUseProgram(program);
+        }
+    }
+
+    void bindVertexArray(GLuint vertex_array) {
+        if (check(VertexArray, vertex_array)) {
+            glBindVertexArray(vertex_array);
+            InstanceBuffer = -1; //instance attribute pointers belong to the vertex array
+            InstanceOffset = -1;
+            InstanceLayersOffset = -1;
+        }
+    }
+
+    void bindArrayBuffer(GLuint buffer) {
+        if (check(ArrayBuffer, buffer)) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        }
+    }
+
+    void bindTexture(int unit, GLenum target, GLuint texture) {
+        if (Textures[unit] == (int64_t)texture) {
+            Skipped += 2; //glActiveTexture + glBindTexture
+            return;
+        }
+        if (check(ActiveUnit, unit)) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+        Textures[unit] = texture;
+        Issued++;
+        glBindTexture(target, texture);
+    }
+
+    //point the instance attributes of the bound vertex array into buffer: model matrices (InstanceModelLocation, 4 columns) at offset
+    //and texture layer pairs (InstanceLayersLocation, 2 unsigned shorts) at layers_offset
+    void setInstanceAttributes(GLuint buffer, GLintptr offset, GLintptr layers_offset) {
+        if (InstanceBuffer == (int64_t)buffer && InstanceOffset == (int64_t)offset && InstanceLayersOffset == (int64_t)layers_offset) {
+            Skipped++;
+            return;
+        }
+        bindArrayBuffer(buffer);
+        for (int column = 0; column < 4; column++) {
+            glVertexAttribPointer(InstanceModelLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + column * sizeof(glm::vec4)));
+        }
+        glVertexAttribIPointer(InstanceLayersLocation, 2, GL_UNSIGNED_SHORT, 2 * sizeof(uint16_t), (void*)layers_offset);
+        InstanceBuffer = buffer;
+        InstanceOffset = offset;
+        InstanceLayersOffset = layers_offset;
+        Issued++;
+    }
+
+private:
+    int64_t Program; //-1 when unknown
+    int64_t VertexArray;
+    int64_t ArrayBuffer;
+    int64_t ActiveUnit;
+    int64_t Textures[MaxTextureUnits];
+    int64_t InstanceBuffer;
+    int64_t InstanceOffset;
+    int64_t InstanceLayersOffset;
+
+    bool check(int64_t& current, int64_t wanted) { //true if the call needs issuing
+        if (current == wanted) {
+            Skipped++;
+            return false;
+        }
+        current = wanted;
+        Issued++;
+        return true;
+    }
+};
+
+struct Material {
+    GLenum Target; //of every texture, GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+    GLuint Textures[GLStateCache::MaxTextureUnits]; //bound to units 0 to TextureCount - 1
+    int TextureCount;
+};
+
+struct DrawCommand {
+    uint64_t Key;
+    GLuint Program;
+    GLuint VertexArray;
+    int MaterialIndex; //from RenderQueue::addMaterial()
+    GLenum IndexType;
+    GLsizei IndexCount;
+    GLintptr IndexOffset; //in bytes, into the vertex array's element buffer
+    GLsizei InstanceCount; //0 for a plain draw
+    GLuint InstanceBuffer; //instanced draws read their model matrices from here, 0 if the vertex array's instance attributes are static
+    GLintptr InstanceOffset;
+    GLintptr InstanceLayersOffset; //and their texture array layers from here
+    GLint ModelLocation; //plain draws set their model matrix uniform here
+    const glm::mat4* Model;
+    GLint LayersLocation; //and their texture array layers here, -1 if the program doesn't use layers
+    uint16_t Layers[2];
+};
+
+class RenderQueue {
+public:
+    struct Stats {
+        int Draws;
+        int StateChanges; //binds issued
+        int StateChangesSkipped; //binds the cache found redundant
+    };
+
+    GLStateCache State; //also used for any binds made around the queue, so the cache stays accurate
+
+    int addMaterial(const Material& material) {
+        Materials.push_back(material);
+        return (int)Materials.size() - 1;
+    }
+
+    //depth is the distance to the camera over the far plane distance, 0 to 1
+    uint64_t makeKey(GLuint program, int material, GLuint vertex_array, float depth) {
+        uint64_t depth_bits = (uint64_t)(std::min(1.0f, std::max(0.0f, depth)) * 0xFFFFFF);
+        return ((uint64_t)getSlot(ProgramSlots, program) & 0xFF) << 56 | ((uint64_t)material & 0xFFF) << 44
+            | ((uint64_t)getSlot(VertexArraySlots, vertex_array) & 0xFFF) << 32 | depth_bits << 8;
+    }
+
+    void clear() {
+        Commands.clear();
+    }
+
+    void submit(const DrawCommand& command) {
+        Commands.push_back(command);
+    }
+
+    size_t getCommandCount() {
+        return Commands.size();
+    }
+
+    void sort() {
+        size_t count = Commands.size();
+        Entries.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            Entries[i].Key = Commands[i].Key;
+            Entries[i].Index = (uint32_t)i;
+        }
+        radixSort(Entries, Scratch);
+    }
+
+    //issue every command in key order, sort() first
+    Stats execute() {
+        int issued = State.Issued;
+        int skipped = State.Skipped;
+        for (size_t i = 0; i < Entries.size(); i++) {
+            const DrawCommand& command = Commands[Entries[i].Index];
+            State.useProgram(command.Program);
+            const Material& material = Materials[command.MaterialIndex];
+            for (int unit = 0; unit < material.TextureCount; unit++) {
+                State.bindTexture(unit, material.Target, material.Textures[unit]);
+            }
+            State.bindVertexArray(command.VertexArray);
+            if (command.InstanceCount > 0) {
+                if (command.InstanceBuffer) {
+                    State.setInstanceAttributes(command.InstanceBuffer, command.InstanceOffset, command.InstanceLayersOffset);
+                }
+                glDrawElementsInstanced(GL_TRIANGLES, command.IndexCount, command.IndexType, (void*)command.IndexOffset, command.InstanceCount);
+            }
+            else {
+                glUniformMatrix4fv(command.ModelLocation, 1, GL_FALSE, glm::value_ptr(*command.Model));
+                if (command.LayersLocation >= 0) {
+                    glUniform2i(command.LayersLocation, command.Layers[0], command.Layers[1]);
+                }
+                glDrawElements(GL_TRIANGLES, command.IndexCount, command.IndexType, (void*)command.IndexOffset);
+            }
+        }
+        Stats stats;
+        stats.Draws = (int)Entries.size();
+        stats.StateChanges = State.Issued - issued;
+        stats.StateChangesSkipped = State.Skipped - skipped;
+        return stats;
+    }
+
+private:
+    struct SortEntry {
+        uint64_t Key;
+        uint32_t Index;
+    };
+
+    std::vector<DrawCommand> Commands;
+    std::vector<SortEntry> Entries;
+    std::vector<SortEntry> Scratch;
+    std::vector<Material> Materials;
+    std::unordered_map<GLuint, int> ProgramSlots; //GL names squeezed into the few key bits available
+    std::unordered_map<GLuint, int> VertexArraySlots;
+
+    static int getSlot(std::unordered_map<GLuint, int>& slots, GLuint name) {
+        auto found = slots.find(name);
+        if (found != slots.end()) {
+            return found->second;
+        }
+        int slot = (int)slots.size();
+        slots[name] = slot;
+        return slot;
+    }
+
+    //least significant digit first, 8 bits a pass. stable, and passes where every key has the same digit are skipped
+    static void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+        size_t count = entries.size();
+        scratch.resize(count);
+        for (int shift = 0; shift < 64; shift += 8) {
+            size_t offsets[256] = {};
+            for (size_t i = 0; i < count; i++) {
+                offsets[(entries[i].Key >> shift) & 0xFF]++;
+            }
+            if (count == 0 || offsets[(entries[0].Key >> shift) & 0xFF] == count) {
+                continue;
+            }
+            size_t total = 0;
+            for (int digit = 0; digit < 256; digit++) {
+                size_t digit_count = offsets[digit];
+                offsets[digit] = total;
+                total += digit_count;
+            }
+            for (size_t i = 0; i < count; i++) {
+                scratch[offsets[(entries[i].Key >> shift) & 0xFF]++] = entries[i];
+            }
+            entries.swap(scratch);
+        }
+    }
+};
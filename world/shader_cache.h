@@ -0,0 +1,126 @@
+#pragma once
+
+/*
+shader cache (.wshd), a linked program as the driver hands it back from glGetProgramBinary:
+
+    Header
+    binary blob (Header.Size bytes, in Header.Format)
+
+the cache for a program lives next to its vertex shader as "<vert>.<frag>[.<defines hash>].wshd". it's keyed by a hash of both sources,
+the defines and the driver's vendor/renderer/version strings, so editing a shader or updating the driver just relinks from source.
+drivers may still reject a binary that matches (glProgramBinary then leaves the program unlinked), callers fall back to compiling
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include "mapped_file.h"
+
+namespace ShaderCache {
+    const uint32_t Magic = 0x44485357; //"WSHD"
+    const uint32_t Version = 1;
+    const std::string Extension = ".wshd";
+
+    struct Header {
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t Key; //see makeKey()
+        uint32_t Format; //binary format enum from glGetProgramBinary
+        uint32_t Size; //of the blob following the header
+    };
+
+    inline uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull) { //64 bit FNV-1a, chain by passing the last result as seed
+        const unsigned char* bytes = (const unsigned char*)data;
+        uint64_t result = seed;
+        for (size_t i = 0; i < size; i++) {
+            result = (result ^ bytes[i]) * 1099511628211ull;
+        }
+        return result;
+    }
+
+    inline uint64_t hashString(std::string text, uint64_t seed = 14695981039346656037ull) {
+        return hash(text.c_str(), text.size() + 1, seed); //with the terminator, so "ab"+"c" and "a"+"bc" differ
+    }
+
+    //binaries only load on the driver that wrote them, so its identity is part of the key
+    inline uint64_t makeKey(const std::string& vert_source, const std::string& frag_source, const std::string& defines) {
+        uint64_t key = hashString(vert_source);
+        key = hashString(frag_source, key);
+        key = hashString(defines, key);
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+            const char* value = (const char*)glGetString(name);
+            key = hashString(value ? value : "", key);
+        }
+        return key;
+    }
+
+    inline std::string getCachePath(std::string vert_filename, std::string frag_filename, const std::string& defines) {
+        std::string path = vert_filename + "." + frag_filename;
+        if (!defines.empty()) { //every permutation of a pair gets its own file, rather than evicting each other
+            char suffix[20];
+            snprintf(suffix, sizeof(suffix), ".%016llx", (unsigned long long)hashString(defines));
+            path += suffix;
+        }
+        return path + Extension;
+    }
+
+    inline bool isSupported() {
+        if (!GLAD_GL_ARB_get_program_binary) {
+            return false;
+        }
+        GLint format_count = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+        return format_count > 0;
+    }
+
+    //try to link program from the cache, true if it's now linked
+    inline bool load(GLuint program, std::string cache_filename, uint64_t key) {
+        MappedFile file = MappedFile(cache_filename);
+        if (!file.isOpen() || file.getSize() < sizeof(Header)) {
+            return false;
+        }
+        const Header* header = (const Header*)file.getData();
+        if (header->Magic != Magic || header->Version != Version || header->Key != key || sizeof(Header) + (uint64_t)header->Size > file.getSize()) {
+            return false;
+        }
+        glProgramBinary(program, header->Format, file.getData() + sizeof(Header), header->Size);
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        return success != 0;
+    }
+
+    //write a linked program's binary, which needs GL_PROGRAM_BINARY_RETRIEVABLE_HINT set before it was linked
+    inline bool save(GLuint program, std::string cache_filename, uint64_t key) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return false;
+        }
+        std::vector<unsigned char> data(sizeof(Header) + length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &format, data.data() + sizeof(Header));
+        if (written <= 0) {
+            return false;
+        }
+
+        Header header = {};
+        header.Magic = Magic;
+        header.Version = Version;
+        header.Key = key;
+        header.Format = format;
+        header.Size = (uint32_t)written;
+        memcpy(data.data(), &header, sizeof(Header));
+
+        std::ofstream file(cache_filename, std::ios::binary | std::ios::trunc);
+        file.write((const char*)data.data(), sizeof(Header) + written);
+        return (bool)file;
+    }
+}
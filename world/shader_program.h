@@ -0,0 +1,465 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include <glad/glad.h>
+
+#include <glm.hpp>
+#include <gtc/type_ptr.hpp>
+
+#include "mesh_file.h"
+#include "shader_cache.h"
+#include "virtual_file_system.h"
+
+const GLuint InstanceModelLocation = 2; //per-instance model matrix, takes 4 consecutive attribute locations (one per column)
+const GLuint InstanceLayersLocation = 6; //per-instance texture array layers (base and overlay)
+const GLuint InstanceTranslationLocation = 7; //per-instance position and spin axis, for programs that build the model matrix themselves
+const GLuint InstanceAxisLocation = 8;
+
+//binding point of the camera uniform block, shared by every program
+const GLuint CameraBlockBinding = 0;
+
+struct CameraBlock { //std140 layout of "uniform Camera" in the vertex shaders (mat4s are 4 aligned vec4 columns, so no padding needed)
+    glm::mat4 View;
+    glm::mat4 Proj;
+};
+
+//linked vertex + fragment shader pair, with every active uniform and attribute looked up once at link time.
+//construction only starts compiling (or loading a cached binary). drivers with KHR_parallel_shader_compile work on every started program
+//at once in the background, so start them all, do other loading, then finish() each (polling isReady() first if there's more to do).
+//acquire() instead of constructing to share one program between every request with the same sources
+class ShaderProgram {
+    struct Sources { //after defines are added
+        std::string Vertex;
+        std::string Fragment;
+    };
+
+public:
+    struct SharingStats {
+        int Requests; //acquire() calls
+        int Unique; //programs they created, the rest were shared
+    };
+
+private:
+    GLuint ID;
+    GLuint VertexShader; //only until finish()
+    GLuint FragmentShader;
+    bool Pending; //started but not yet finished
+    bool Linked; //result of finish()
+    bool FromCache;
+    std::string Name; //source filenames, for errors
+    std::string CachePath; //empty if the cache is off
+    uint64_t CacheKey;
+    std::unordered_map<std::string, GLint> UniformLocations;
+    std::unordered_map<std::string, GLint> AttribLocations;
+    std::unordered_map<std::string, GLuint> UniformBlockIndices;
+
+public:
+    //defines are lines inserted after each source's #version, e.g. "#define SHADOWS 1\n"
+    ShaderProgram(std::string vert_filename, std::string frag_filename, std::string defines = "", bool use_cache = true)
+        : ShaderProgram(vert_filename, frag_filename, defines, use_cache, readSources(vert_filename, frag_filename, defines)) {
+    }
+
+    //the program for these sources and defines, shared with every other acquire() of the same contents (whatever the filenames) that's
+    //still alive. it may already be finished, finish() again is free
+    static std::shared_ptr<ShaderProgram> acquire(std::string vert_filename, std::string frag_filename, std::string defines = "", bool use_cache = true) {
+        Sources sources = readSources(vert_filename, frag_filename, defines);
+        uint64_t key = ShaderCache::hashString(sources.Fragment, ShaderCache::hashString(sources.Vertex));
+        Registry& registry = getRegistry();
+        registry.Stats.Requests++;
+        auto found = registry.Programs.find(key);
+        if (found != registry.Programs.end()) {
+            std::shared_ptr<ShaderProgram> shared = found->second.lock();
+            if (shared) {
+                return shared;
+            }
+        }
+        std::shared_ptr<ShaderProgram> program(new ShaderProgram(vert_filename, frag_filename, defines, use_cache, sources));
+        registry.Programs[key] = program;
+        registry.Stats.Unique++;
+        return program;
+    }
+
+    static SharingStats getSharingStats() {
+        return getRegistry().Stats;
+    }
+
+private:
+    ShaderProgram(std::string vert_filename, std::string frag_filename, std::string defines, bool use_cache, const Sources& sources) {
+        VertexShader = 0;
+        FragmentShader = 0;
+        Pending = true;
+        Linked = false;
+        FromCache = false;
+        Name = vert_filename + ", " + frag_filename;
+        CacheKey = 0;
+
+        const std::string& vert_string = sources.Vertex;
+        const std::string& frag_string = sources.Fragment;
+
+        ID = glCreateProgram();
+        if (use_cache && ShaderCache::isSupported()) {
+            CachePath = ShaderCache::getCachePath(vert_filename, frag_filename, defines);
+            CacheKey = ShaderCache::makeKey(vert_string, frag_string, defines);
+            FromCache = ShaderCache::load(ID, CachePath, CacheKey);
+        }
+        if (FromCache) {
+            return; //attribute locations were bound when the cached program was linked
+        }
+        if (!CachePath.empty()) {
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        //compile and link without checking the results, which would wait for the driver
+        VertexShader = compileShader(GL_VERTEX_SHADER, vert_string);
+        FragmentShader = compileShader(GL_FRAGMENT_SHADER, frag_string);
+        glAttachShader(ID, VertexShader);
+        glAttachShader(ID, FragmentShader);
+
+        //fix attribute locations so every program can share the same VAO
+        glBindAttribLocation(ID, MeshFile::SemanticPosition, MeshFile::getSemanticName(MeshFile::SemanticPosition));
+        glBindAttribLocation(ID, MeshFile::SemanticTexCoord, MeshFile::getSemanticName(MeshFile::SemanticTexCoord));
+        glBindAttribLocation(ID, InstanceModelLocation, "in_model");
+        glBindAttribLocation(ID, InstanceLayersLocation, "in_layers");
+        glBindAttribLocation(ID, InstanceTranslationLocation, "in_translation");
+        glBindAttribLocation(ID, InstanceAxisLocation, "in_axis");
+
+        glLinkProgram(ID);
+    }
+
+public:
+    ~ShaderProgram() {
+        deleteShaders();
+        if (ID) {
+            glDeleteProgram(ID);
+        }
+    }
+
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    ShaderProgram(ShaderProgram&& other) noexcept : ID(other.ID), VertexShader(other.VertexShader), FragmentShader(other.FragmentShader), Pending(other.Pending), Linked(other.Linked), FromCache(other.FromCache),
+        Name(std::move(other.Name)), CachePath(std::move(other.CachePath)), CacheKey(other.CacheKey),
+        UniformLocations(std::move(other.UniformLocations)), AttribLocations(std::move(other.AttribLocations)), UniformBlockIndices(std::move(other.UniformBlockIndices)) {
+        other.ID = 0;
+        other.VertexShader = 0;
+        other.FragmentShader = 0;
+        other.Pending = false;
+        other.Linked = false;
+    }
+
+    //ask the driver to compile on as many threads as it likes, if it can. call once after loading gl
+    static void enableParallelCompile() {
+        if (GLAD_GL_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        }
+    }
+
+    //would finish() return without waiting on the driver. always true without KHR_parallel_shader_compile, where there's no way to tell
+    bool isReady() {
+        if (!Pending || FromCache || !GLAD_GL_KHR_parallel_shader_compile) {
+            return true;
+        }
+        GLint done = GL_TRUE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+        return done != GL_FALSE;
+    }
+
+    //wait for the link, report errors, look up uniforms and attributes, and write the cache. must be called before anything below.
+    //returns whether the program linked, on every call
+    bool finish() {
+        if (!Pending) {
+            return Linked;
+        }
+        Pending = false;
+
+        GLint success = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (!success) {
+            for (GLuint shader : { VertexShader, FragmentShader }) {
+                GLint compiled = GL_TRUE;
+                glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+                if (!compiled) {
+                    std::cout << "ERROR::SHADER::" << (shader == VertexShader ? "VERTEX" : "FRAGMENT") << "::COMPILATION_FAILED (" << Name << ")\n" << getShaderLog(shader) << std::endl;
+                }
+            }
+            std::cout << "ERROR::PROGRAM::LINKING_FAILED (" << Name << ")\n" << getProgramLog() << std::endl;
+        }
+        deleteShaders(); //linked into the program now
+
+        if (success) {
+            reflect();
+            bindUniformBlock("Camera", CameraBlockBinding);
+            if (!FromCache && !CachePath.empty() && !ShaderCache::save(ID, CachePath, CacheKey)) {
+                std::cout << "Failed to write shader cache " << CachePath << std::endl;
+            }
+        }
+        Linked = success != 0;
+        return Linked;
+    }
+
+    bool isFromCache() {
+        return FromCache;
+    }
+
+    GLuint getID() {
+        return ID;
+    }
+
+    void use() {
+        glUseProgram(ID);
+    }
+
+    //cached lookups, -1 if the program has no such active uniform/attribute
+    GLint getUniformLocation(std::string name) {
+        auto found = UniformLocations.find(name);
+        return found == UniformLocations.end() ? -1 : found->second;
+    }
+
+    GLint getAttribLocation(std::string name) {
+        auto found = AttribLocations.find(name);
+        return found == AttribLocations.end() ? -1 : found->second;
+    }
+
+    void bindUniformBlock(std::string name, GLuint binding) {
+        auto found = UniformBlockIndices.find(name);
+        if (found != UniformBlockIndices.end()) {
+            glUniformBlockBinding(ID, found->second, binding);
+        }
+    }
+
+    //typed setters, the program must be in use. hot paths should look the location up once and use the location overloads
+    void setInt(GLint location, int value) {
+        glUniform1i(location, value);
+    }
+    void setFloat(GLint location, float value) {
+        glUniform1f(location, value);
+    }
+    void setVec3(GLint location, const glm::vec3& value) {
+        glUniform3fv(location, 1, glm::value_ptr(value));
+    }
+    void setVec4(GLint location, const glm::vec4& value) {
+        glUniform4fv(location, 1, glm::value_ptr(value));
+    }
+    void setMat4(GLint location, const glm::mat4& value) {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+
+    void setInt(std::string name, int value) {
+        setInt(getUniformLocation(name), value);
+    }
+    void setFloat(std::string name, float value) {
+        setFloat(getUniformLocation(name), value);
+    }
+    void setVec3(std::string name, const glm::vec3& value) {
+        setVec3(getUniformLocation(name), value);
+    }
+    void setVec4(std::string name, const glm::vec4& value) {
+        setVec4(getUniformLocation(name), value);
+    }
+    void setMat4(std::string name, const glm::mat4& value) {
+        setMat4(getUniformLocation(name), value);
+    }
+
+private:
+    struct Registry { //programs by a hash of their sources, GL thread only
+        std::unordered_map<uint64_t, std::weak_ptr<ShaderProgram>> Programs;
+        SharingStats Stats = {};
+    };
+
+    static Registry& getRegistry() {
+        static Registry registry;
+        return registry;
+    }
+
+    static Sources readSources(std::string vert_filename, std::string frag_filename, const std::string& defines) {
+        return { addDefines(readSource(vert_filename), defines), addDefines(readSource(frag_filename), defines) };
+    }
+
+    static std::string readSource(std::string filename) {
+        VirtualFile file = VirtualFileSystem::getDefault().read(filename);
+        if (!file.isOpen()) {
+            std::cout << "Failed to read shader " << filename << std::endl;
+            return "";
+        }
+        return std::string((const char*)file.getData(), file.getSize());
+    }
+
+    static std::string addDefines(const std::string& source, const std::string& defines) {
+        if (defines.empty()) {
+            return source;
+        }
+        size_t line_end = source.compare(0, 8, "#version") == 0 ? source.find('\n') : std::string::npos; //#version has to stay first
+        if (line_end == std::string::npos) {
+            return defines + source;
+        }
+        return source.substr(0, line_end + 1) + defines + source.substr(line_end + 1);
+    }
+
+    static GLuint compileShader(GLenum type, const std::string& source) {
+        const char* c_source = source.c_str();
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &c_source, NULL);
+        glCompileShader(shader);
+        return shader;
+    }
+
+    //whole info logs, however long
+    static std::string getShaderLog(GLuint shader) {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string log(std::max(length, 1), '\0');
+        GLsizei written = 0;
+        glGetShaderInfoLog(shader, (GLsizei)log.size(), &written, &log[0]);
+        return log.substr(0, written);
+    }
+
+    std::string getProgramLog() {
+        GLint length = 0;
+        glGetProgramiv(ID, GL_INFO_LOG_LENGTH, &length);
+        std::string log(std::max(length, 1), '\0');
+        GLsizei written = 0;
+        glGetProgramInfoLog(ID, (GLsizei)log.size(), &written, &log[0]);
+        return log.substr(0, written);
+    }
+
+    void deleteShaders() {
+        for (GLuint shader : { VertexShader, FragmentShader }) {
+            if (shader) {
+                if (ID) {
+                    glDetachShader(ID, shader);
+                }
+                glDeleteShader(shader);
+            }
+        }
+        VertexShader = 0;
+        FragmentShader = 0;
+    }
+
+    void reflect() { //query every active uniform, attribute and uniform block once so nothing is looked up by string at draw time
+        GLint count;
+        GLint max_length;
+        GLint size;
+        GLenum type;
+
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+        std::string name(std::max(max_length, 1), '\0');
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length;
+            glGetActiveUniform(ID, i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+            std::string uniform_name = name.substr(0, length);
+            GLint location = glGetUniformLocation(ID, uniform_name.c_str());
+            if (location < 0) {
+                continue; //member of a uniform block
+            }
+            UniformLocations[uniform_name] = location;
+            size_t bracket = uniform_name.find("[0]");
+            if (bracket != std::string::npos) { //arrays are reported as "name[0]", also allow plain "name"
+                UniformLocations[uniform_name.substr(0, bracket)] = location;
+            }
+        }
+
+        glGetProgramiv(ID, GL_ACTIVE_ATTRIBUTES, &count);
+        glGetProgramiv(ID, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+        name.assign(std::max(max_length, 1), '\0');
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length;
+            glGetActiveAttrib(ID, i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+            std::string attrib_name = name.substr(0, length);
+            AttribLocations[attrib_name] = glGetAttribLocation(ID, attrib_name.c_str());
+        }
+
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length);
+        name.assign(std::max(max_length, 1), '\0');
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length;
+            glGetActiveUniformBlockName(ID, i, (GLsizei)name.size(), &length, &name[0]);
+            UniformBlockIndices[name.substr(0, length)] = i;
+        }
+    }
+};
+
+//specialized versions of one vertex + fragment pair, each compiled with a combination of feature #defines. bit i of a variant mask
+//defines Features[i], so shaders can #if out work a draw doesn't need. variants are started on first use (or up front with start()),
+//and setup runs once on each after it links, for uniforms that never change (sampler units and such). variants are acquired, so
+//identical sources under other filenames share their program
+class ShaderVariants {
+    struct Variant {
+        std::shared_ptr<ShaderProgram> Program;
+        bool SetUp;
+    };
+
+    std::string VertFilename;
+    std::string FragFilename;
+    std::vector<std::string> Features;
+    std::function<void(ShaderProgram&)> Setup;
+    bool UseCache;
+    std::unordered_map<uint32_t, Variant> Variants;
+
+public:
+    ShaderVariants(std::string vert_filename, std::string frag_filename, std::vector<std::string> features, std::function<void(ShaderProgram&)> setup, bool use_cache = true) {
+        VertFilename = vert_filename;
+        FragFilename = frag_filename;
+        Features = features;
+        Setup = setup;
+        UseCache = use_cache;
+    }
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+    std::string getDefines(uint32_t mask) {
+        std::string defines;
+        for (size_t i = 0; i < Features.size(); i++) {
+            if (mask & (1u << i)) {
+                defines += "#define " + Features[i] + " 1\n";
+            }
+        }
+        return defines;
+    }
+
+    //begin compiling a variant without waiting for it
+    ShaderProgram& start(uint32_t mask) {
+        Variant& variant = Variants[mask];
+        if (!variant.Program) {
+            variant.Program = ShaderProgram::acquire(VertFilename, FragFilename, getDefines(mask), UseCache);
+            variant.SetUp = false;
+        }
+        return *variant.Program;
+    }
+
+    //a linked, set up variant, compiling it now if it hasn't been started. leaves the variant's program in use if it had to be set up
+    ShaderProgram& get(uint32_t mask) {
+        Variant& variant = Variants[mask];
+        if (!variant.Program) {
+            start(mask);
+        }
+        if (!variant.SetUp) {
+            if (variant.Program->finish()) {
+                variant.Program->use();
+                Setup(*variant.Program);
+            }
+            variant.SetUp = true;
+        }
+        return *variant.Program;
+    }
+
+    //every variant started so far, e.g. to finish them as the driver gets them ready
+    std::vector<ShaderProgram*> getStarted() {
+        std::vector<ShaderProgram*> programs;
+        for (auto& variant : Variants) {
+            programs.push_back(variant.second.Program.get());
+        }
+        return programs;
+    }
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+//ring of per frame segments in one buffer object, for data rewritten every frame (instance transforms, per frame uniforms).
+//the cpu writes segment n while the gpu is still reading segments n - 1 and n - 2, a fence per segment guards against lapping it.
+//with ARB_buffer_storage the buffer is mapped once, persistently and coherently. otherwise each frame's segment is mapped unsynchronized
+//(the fence already guarantees the gpu is done with it) and invalidated, and must be unmapped with commit() before drawing
+class StreamBuffer {
+public:
+    struct Allocation {
+        void* Data; //write here
+        GLintptr Offset; //then source from here in the buffer
+    };
+
+    static const int SegmentCount = 3;
+    static const size_t AllocationSlack = 1024; //added to every frame's reservation to cover alignment padding
+
+    StreamBuffer(size_t segment_size = 1 << 20) {
+        Buffer = 0;
+        SegmentSize = 0;
+        Persistent = GLAD_GL_ARB_buffer_storage != 0;
+        PersistentData = NULL;
+        MappedData = NULL;
+        Segment = 0;
+        Used = 0;
+        for (int i = 0; i < SegmentCount; i++) {
+            Fences[i] = 0;
+        }
+        FrameBytes = 0;
+        FrameWaits = 0;
+        GLint uniform_alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+        SegmentAlignment = std::max((size_t)uniform_alignment, (size_t)16);
+        create(segment_size);
+    }
+
+    ~StreamBuffer() {
+        destroy();
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    //move to the next segment, growing the buffer first if frame_bytes won't fit. normally returns immediately,
+    //only waits if the gpu is still reading what was written into this segment SegmentCount frames ago
+    void beginFrame(size_t frame_bytes) {
+        FrameBytes = 0;
+        FrameWaits = 0;
+        if (frame_bytes + AllocationSlack > SegmentSize) {
+            destroy();
+            create(std::max(SegmentSize * 2, frame_bytes + AllocationSlack)); //a fresh buffer has no fences to wait on
+        }
+
+        if (Fences[Segment]) {
+            GLenum result = glClientWaitSync(Fences[Segment], 0, 0);
+            if (result == GL_TIMEOUT_EXPIRED) {
+                FrameWaits++;
+                while (result == GL_TIMEOUT_EXPIRED) {
+                    result = glClientWaitSync(Fences[Segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1 ms at a time
+                }
+            }
+            glDeleteSync(Fences[Segment]);
+            Fences[Segment] = 0;
+        }
+        Used = 0;
+    }
+
+    //size bytes from this frame's segment, offset (from the start of the buffer) a multiple of alignment. NULL data if the frame's
+    //reservation is exceeded
+    Allocation allocate(size_t size, size_t alignment = 16) {
+        Allocation allocation = { NULL, 0 };
+        size_t segment_start = Segment * SegmentSize;
+        size_t start = (segment_start + Used + alignment - 1) / alignment * alignment - segment_start;
+        if (start + size > SegmentSize) {
+            std::cout << "Stream buffer segment overflow (" << start + size << " > " << SegmentSize << " bytes)" << std::endl;
+            return allocation;
+        }
+        unsigned char* segment_data = map();
+        if (!segment_data) {
+            return allocation;
+        }
+        allocation.Data = segment_data + start;
+        allocation.Offset = (GLintptr)(Segment * SegmentSize + start);
+        Used = start + size;
+        FrameBytes += size;
+        return allocation;
+    }
+
+    void commit() { //make this frame's writes visible to the gpu, before any draw reads them
+        if (MappedData) {
+            glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+            glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, Used);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            MappedData = NULL;
+        }
+    }
+
+    void endFrame() { //after the last draw reading this frame's segment
+        commit();
+        Fences[Segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        Segment = (Segment + 1) % SegmentCount;
+    }
+
+    GLuint getBuffer() {
+        return Buffer;
+    }
+
+    bool isPersistent() {
+        return Persistent;
+    }
+
+    size_t getFrameBytes() { //allocated so far this frame
+        return FrameBytes;
+    }
+
+    int getFrameWaits() { //times this frame had to wait on the gpu (0 unless the gpu is SegmentCount frames behind)
+        return FrameWaits;
+    }
+
+private:
+    GLuint Buffer;
+    size_t SegmentSize; //a multiple of SegmentAlignment, so every segment starts aligned for any binding
+    size_t SegmentAlignment; //GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, at least 16
+    bool Persistent;
+    unsigned char* PersistentData; //whole buffer, when persistently mapped
+    unsigned char* MappedData; //this frame's segment, when mapped per frame
+    int Segment;
+    size_t Used; //bytes allocated from the current segment
+    GLsync Fences[SegmentCount];
+    size_t FrameBytes;
+    int FrameWaits;
+
+    void create(size_t segment_size) {
+        SegmentSize = (segment_size + SegmentAlignment - 1) / SegmentAlignment * SegmentAlignment;
+        GLsizeiptr size = (GLsizeiptr)(SegmentSize * SegmentCount);
+        glGenBuffers(1, &Buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+        if (Persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+            PersistentData = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+            if (!PersistentData) { //fall back to mapping every frame
+                Persistent = false;
+                glDeleteBuffers(1, &Buffer);
+                create(segment_size);
+                return;
+            }
+        }
+        else {
+            glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+        }
+    }
+
+    void destroy() {
+        commit();
+        for (int i = 0; i < SegmentCount; i++) {
+            if (Fences[i]) {
+                glDeleteSync(Fences[i]);
+                Fences[i] = 0;
+            }
+        }
+        if (Buffer) {
+            if (PersistentData) {
+                glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+                PersistentData = NULL;
+            }
+            glDeleteBuffers(1, &Buffer); //the driver keeps it alive until frames still reading it finish
+            Buffer = 0;
+        }
+        Segment = 0;
+        Used = 0;
+    }
+
+    unsigned char* map() { //pointer to the start of the current segment
+        if (Persistent) {
+            return PersistentData + Segment * SegmentSize;
+        }
+        if (!MappedData) {
+            glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+            MappedData = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, Segment * SegmentSize, SegmentSize,
+                GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+        }
+        return MappedData;
+    }
+};
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include <stb_image.h>
+
+#include "texture_loader.h"
+#include "virtual_file_system.h"
+
+//packs textures into the layers of GL_TEXTURE_2D_ARRAYs, one array per size bucket (square, power of 2), so objects with different
+//textures can share a program, a binding and a draw call, picking their image with a layer index. images are resampled to their bucket's size.
+//layers are content addressed: adding an image whose bytes match one already added (whatever its filename) shares that layer, and a
+//layer is only freed for reuse once every handle to it is gone
+class TextureArrayManager {
+public:
+    struct Layer {
+        int Bucket; //-1 if the image couldn't be read
+        int Index;
+    };
+    typedef std::shared_ptr<const Layer> Handle;
+
+    struct Stats {
+        int Requests; //add() calls that found their image
+        int Unique; //layers those needed
+        uint64_t Bytes; //of the unique layers, with their mips
+        uint64_t SavedBytes; //the layers sharing saved
+    };
+
+    TextureArrayManager(TextureLoader& loader, int max_size = 1024, int min_size = 64) : Loader(loader) {
+        MaxSize = max_size;
+        MinSize = std::min(min_size, max_size);
+    }
+
+    ~TextureArrayManager() {
+        for (int i = 0; i < Buckets.size(); i++) {
+            if (Buckets[i].Texture) {
+                Loader.cancelLayers(Buckets[i].Texture);
+                glDeleteTextures(1, &Buckets[i].Texture);
+            }
+        }
+    }
+
+    TextureArrayManager(const TextureArrayManager&) = delete;
+    TextureArrayManager& operator=(const TextureArrayManager&) = delete;
+
+    //reserve a layer for an image (only its header is read and its contents hashed here), its pixels are loaded by the TextureLoader.
+    //the layer stays reserved while the handle (or a copy) lives, the manager must outlive them all
+    Handle add(std::string filename) {
+        Layer layer = { -1, -1 };
+        VirtualFile file = VirtualFileSystem::getDefault().read(filename);
+        int width, height, channels;
+        if (!file.isOpen() || !stbi_info_from_memory(file.getData(), (int)file.getSize(), &width, &height, &channels)) {
+            std::cout << "Failed to read texture " << filename << std::endl;
+            return Handle(new Layer(layer));
+        }
+        CurrentStats.Requests++;
+
+        uint64_t content_hash = TextureCache::hash(file.getData(), file.getSize());
+        auto shared = Contents.find(content_hash);
+        if (shared != Contents.end()) {
+            Bucket& bucket = Buckets[shared->second.Bucket];
+            bucket.References[shared->second.Index]++;
+            CurrentStats.SavedBytes += getLayerBytes(bucket.Size);
+            return makeHandle(shared->second);
+        }
+
+        int size = MinSize; //nearest power of 2 to the larger side, so neither side loses much detail
+        while (size < MaxSize && size * 3 / 2 < std::max(width, height)) {
+            size *= 2;
+        }
+        layer.Bucket = 0;
+        while (layer.Bucket < Buckets.size() && Buckets[layer.Bucket].Size != size) {
+            layer.Bucket++;
+        }
+        if (layer.Bucket == Buckets.size()) {
+            Buckets.push_back({ size, 0, 0, {}, {}, {}, {} });
+        }
+
+        Bucket& bucket = Buckets[layer.Bucket];
+        if (!bucket.FreeLayers.empty()) { //reuse a released layer
+            layer.Index = bucket.FreeLayers.back();
+            bucket.FreeLayers.pop_back();
+            bucket.Filenames[layer.Index] = filename;
+            bucket.Hashes[layer.Index] = content_hash;
+            bucket.References[layer.Index] = 1;
+        }
+        else {
+            layer.Index = (int)bucket.Filenames.size();
+            bucket.Filenames.push_back(filename);
+            bucket.Hashes.push_back(content_hash);
+            bucket.References.push_back(1);
+        }
+        //already allocated, otherwise queued when the array grows in getTexture(). on a reused layer this replaces any load of the
+        //released image still in flight
+        if (layer.Index < bucket.Capacity) {
+            Loader.loadLayer(bucket.Texture, layer.Index, bucket.Size, filename);
+        }
+        Contents[content_hash] = layer;
+        CurrentStats.Unique++;
+        CurrentStats.Bytes += getLayerBytes(bucket.Size);
+        return makeHandle(layer);
+    }
+
+    Stats getStats() {
+        return CurrentStats;
+    }
+
+    static uint64_t getLayerBytes(int size) { //rgba8, every mip level
+        uint64_t bytes = 0;
+        for (; size >= 1; size /= 2) {
+            bytes += (uint64_t)size * size * 4;
+        }
+        return bytes;
+    }
+
+    int getBucketCount() {
+        return (int)Buckets.size();
+    }
+
+    int getBucketSize(int bucket) {
+        return Buckets[bucket].Size;
+    }
+
+    int getLayerCount(int bucket) {
+        return (int)Buckets[bucket].Filenames.size();
+    }
+
+    //the array for a bucket, allocating it (or reallocating it bigger and reloading every layer) if layers were added since.
+    //must be called on the GL thread, ideally once every image is added so the array is only allocated once
+    GLuint getTexture(int bucket) {
+        Bucket& target = Buckets[bucket];
+        if (target.Filenames.size() > target.Capacity) {
+            allocate(target, std::max((int)target.Filenames.size(), target.Capacity * 2));
+        }
+        return target.Texture;
+    }
+
+private:
+    struct Bucket {
+        int Size;
+        GLuint Texture;
+        int Capacity; //layers allocated
+        std::vector<std::string> Filenames; //one per layer
+        std::vector<uint64_t> Hashes; //of each layer's image contents
+        std::vector<int> References; //handles to each layer, 0 once it's free
+        std::vector<int> FreeLayers;
+    };
+
+    TextureLoader& Loader;
+    int MaxSize;
+    int MinSize;
+    std::vector<Bucket> Buckets;
+    std::unordered_map<uint64_t, Layer> Contents; //content hash -> the layer holding it
+    Stats CurrentStats = {};
+
+    Handle makeHandle(Layer layer) {
+        return Handle(new Layer(layer), [this](const Layer* released) {
+            release(*released);
+            delete released;
+        });
+    }
+
+    void release(Layer layer) { //the layer keeps its old pixels until it's reused, nothing may be drawing with it by then
+        Bucket& bucket = Buckets[layer.Bucket];
+        if (--bucket.References[layer.Index] > 0) {
+            return;
+        }
+        Contents.erase(bucket.Hashes[layer.Index]);
+        bucket.FreeLayers.push_back(layer.Index);
+        CurrentStats.Bytes -= getLayerBytes(bucket.Size);
+    }
+
+    void allocate(Bucket& bucket, int capacity) {
+        if (bucket.Texture) {
+            Loader.cancelLayers(bucket.Texture); //every layer is reloaded below
+            glDeleteTextures(1, &bucket.Texture);
+        }
+        glGenTextures(1, &bucket.Texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, bucket.Texture);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+        //every level filled with the same grey placeholder the 2D textures show until their image arrives
+        int level_count = TextureLoader::getLevelCount(bucket.Size);
+        std::vector<unsigned char> placeholder((size_t)bucket.Size * bucket.Size * 4 * capacity, 128);
+        for (size_t i = 3; i < placeholder.size(); i += 4) {
+            placeholder[i] = 255;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int level = 0, size = bucket.Size; level < level_count; level++, size = std::max(1, size / 2)) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, capacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder.data());
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, level_count - 1);
+        bucket.Capacity = capacity;
+
+        for (int i = 0; i < bucket.Filenames.size(); i++) {
+            if (bucket.References[i] > 0) {
+                Loader.loadLayer(bucket.Texture, i, bucket.Size, bucket.Filenames[i]);
+            }
+        }
+    }
+};
@@ -0,0 +1,255 @@
+#pragma once
+
+/*
+texture cache (.wtex), a decoded image with its full mip chain precomputed so it can be uploaded level by level straight out of a memory mapping:
+
+    Header
+    Level[Header.LevelCount]
+    level blobs, each aligned to BlobAlignment (tightly packed rows, Header.Channels bytes per pixel)
+
+the cache for "image.jpg" lives next to it as "image.jpg.wtex" and is rebuilt whenever the hash of the source file's contents changes.
+both are read through the VirtualFileSystem, so a package can ship prebuilt caches. a stale packed cache is rebuilt as a loose file on
+every run until the package is rebuilt too
+images are cached as stbi_load returns them, so stbi_set_flip_vertically_on_load must be set the same way whenever the cache is built
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include <stb_image.h>
+
+#include "mapped_file.h"
+#include "virtual_file_system.h"
+
+namespace TextureCache {
+    const uint32_t Magic = 0x58455457; //"WTEX"
+    const uint32_t Version = 1;
+    const uint64_t BlobAlignment = 64;
+    const uint32_t MaxLevels = 32;
+    const std::string Extension = ".wtex";
+
+    struct Header {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t Channels;
+        uint32_t LevelCount;
+        uint64_t SourceHash; //hash of the source image file contents
+    };
+
+    struct Level {
+        uint32_t Width;
+        uint32_t Height;
+        uint64_t Offset; //from the start of the file
+        uint64_t Size;
+    };
+
+    inline std::string getCachePath(std::string source_filename) {
+        return source_filename + Extension;
+    }
+
+    inline uint64_t hash(const unsigned char* data, size_t size) { //64 bit FNV-1a
+        uint64_t result = 14695981039346656037ull;
+        for (size_t i = 0; i < size; i++) {
+            result = (result ^ data[i]) * 1099511628211ull;
+        }
+        return result;
+    }
+
+    inline const Level* getLevels(const Header* header) {
+        return (const Level*)(header + 1);
+    }
+
+    //returns the header if data holds a well-formed cache built from a source with the given hash, NULL otherwise
+    inline const Header* validate(const unsigned char* data, size_t size, uint64_t source_hash) {
+        if (data == NULL || size < sizeof(Header)) {
+            return NULL;
+        }
+        const Header* header = (const Header*)data;
+        if (header->Magic != Magic || header->Version != Version || header->SourceHash != source_hash || header->LevelCount == 0 || header->LevelCount > MaxLevels) {
+            return NULL;
+        }
+        if (sizeof(Header) + header->LevelCount * sizeof(Level) > size) {
+            return NULL;
+        }
+        const Level* levels = getLevels(header);
+        for (uint32_t i = 0; i < header->LevelCount; i++) {
+            if (levels[i].Offset + levels[i].Size > size || levels[i].Size != (uint64_t)levels[i].Width * levels[i].Height * header->Channels) {
+                return NULL;
+            }
+        }
+        return header;
+    }
+
+    inline const float* getSRGBToLinearTable() {
+        static std::vector<float> table = []() {
+            std::vector<float> values(256);
+            for (int i = 0; i < 256; i++) {
+                float c = i / 255.0f;
+                values[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return values;
+        }();
+        return table.data();
+    }
+
+    inline unsigned char linearToSRGB(float c) {
+        c = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+        return (unsigned char)std::min(255.0f, std::max(0.0f, c * 255.0f + 0.5f));
+    }
+
+    //2x2 box filter averaged in linear space (colour channels are sRGB encoded, a 4th channel is treated as linear alpha)
+    inline void downsample(const unsigned char* src, int src_width, int src_height, int channels, unsigned char* dst, int dst_width, int dst_height) {
+        const float* to_linear = getSRGBToLinearTable();
+        int color_channels = channels == 4 ? 3 : channels;
+        for (int y = 0; y < dst_height; y++) {
+            int y0 = std::min(y * 2, src_height - 1);
+            int y1 = std::min(y * 2 + 1, src_height - 1);
+            for (int x = 0; x < dst_width; x++) {
+                int x0 = std::min(x * 2, src_width - 1);
+                int x1 = std::min(x * 2 + 1, src_width - 1);
+                const unsigned char* p00 = src + ((size_t)y0 * src_width + x0) * channels;
+                const unsigned char* p01 = src + ((size_t)y0 * src_width + x1) * channels;
+                const unsigned char* p10 = src + ((size_t)y1 * src_width + x0) * channels;
+                const unsigned char* p11 = src + ((size_t)y1 * src_width + x1) * channels;
+                unsigned char* out = dst + ((size_t)y * dst_width + x) * channels;
+                for (int c = 0; c < color_channels; c++) {
+                    out[c] = linearToSRGB((to_linear[p00[c]] + to_linear[p01[c]] + to_linear[p10[c]] + to_linear[p11[c]]) * 0.25f);
+                }
+                if (channels == 4) {
+                    out[3] = (unsigned char)((p00[3] + p01[3] + p10[3] + p11[3] + 2) / 4);
+                }
+            }
+        }
+    }
+
+    //bilinear resample to a size x size rgba image (missing channels filled in: grey copied to rgb, alpha 255). meant for shrinking
+    //by less than 2x or enlarging, so pick the source from the mip chain first
+    inline void resample(const unsigned char* src, int src_width, int src_height, int channels, unsigned char* dst, int size) {
+        float scale_x = (float)src_width / size;
+        float scale_y = (float)src_height / size;
+        for (int y = 0; y < size; y++) {
+            float sy = std::max(0.0f, (y + 0.5f) * scale_y - 0.5f);
+            int y0 = std::min((int)sy, src_height - 1);
+            int y1 = std::min(y0 + 1, src_height - 1);
+            float fy = sy - y0;
+            for (int x = 0; x < size; x++) {
+                float sx = std::max(0.0f, (x + 0.5f) * scale_x - 0.5f);
+                int x0 = std::min((int)sx, src_width - 1);
+                int x1 = std::min(x0 + 1, src_width - 1);
+                float fx = sx - x0;
+                const unsigned char* p00 = src + ((size_t)y0 * src_width + x0) * channels;
+                const unsigned char* p01 = src + ((size_t)y0 * src_width + x1) * channels;
+                const unsigned char* p10 = src + ((size_t)y1 * src_width + x0) * channels;
+                const unsigned char* p11 = src + ((size_t)y1 * src_width + x1) * channels;
+                float texel[4] = { 0.0f, 0.0f, 0.0f, 255.0f };
+                for (int c = 0; c < channels; c++) {
+                    float top = p00[c] + (p01[c] - p00[c]) * fx;
+                    float bottom = p10[c] + (p11[c] - p10[c]) * fx;
+                    texel[c] = top + (bottom - top) * fy;
+                }
+                if (channels <= 2) { //grey (and alpha)
+                    texel[3] = channels == 2 ? texel[1] : 255.0f;
+                    texel[1] = texel[0];
+                    texel[2] = texel[0];
+                }
+                unsigned char* out = dst + ((size_t)y * size + x) * 4;
+                for (int c = 0; c < 4; c++) {
+                    out[c] = (unsigned char)(texel[c] + 0.5f);
+                }
+            }
+        }
+    }
+
+    //decode a source image, build its mip chain and write the cache file
+    inline bool build(const unsigned char* source_data, size_t source_size, uint64_t source_hash, std::string cache_filename) {
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load_from_memory(source_data, (int)source_size, &width, &height, &channels, 0);
+        if (!pixels) {
+            return false;
+        }
+
+        std::vector<std::vector<unsigned char>> level_data;
+        std::vector<Level> levels;
+        level_data.push_back(std::vector<unsigned char>(pixels, pixels + (size_t)width * height * channels));
+        stbi_image_free(pixels);
+        levels.push_back({ (uint32_t)width, (uint32_t)height, 0, level_data[0].size() });
+        while ((levels.back().Width > 1 || levels.back().Height > 1) && levels.size() < MaxLevels) {
+            const Level& previous = levels.back();
+            uint32_t level_width = std::max(1u, previous.Width / 2);
+            uint32_t level_height = std::max(1u, previous.Height / 2);
+            std::vector<unsigned char> data((size_t)level_width * level_height * channels);
+            downsample(level_data.back().data(), previous.Width, previous.Height, channels, data.data(), level_width, level_height);
+            levels.push_back({ level_width, level_height, 0, data.size() });
+            level_data.push_back(std::move(data));
+        }
+
+        Header header = {};
+        header.Magic = Magic;
+        header.Version = Version;
+        header.Width = width;
+        header.Height = height;
+        header.Channels = channels;
+        header.LevelCount = (uint32_t)levels.size();
+        header.SourceHash = source_hash;
+
+        uint64_t offset = sizeof(Header) + levels.size() * sizeof(Level);
+        for (int i = 0; i < levels.size(); i++) {
+            offset = (offset + BlobAlignment - 1) / BlobAlignment * BlobAlignment;
+            levels[i].Offset = offset;
+            offset += levels[i].Size;
+        }
+
+        std::vector<unsigned char> file_data(offset, 0);
+        memcpy(file_data.data(), &header, sizeof(Header));
+        memcpy(file_data.data() + sizeof(Header), levels.data(), levels.size() * sizeof(Level));
+        for (int i = 0; i < levels.size(); i++) {
+            memcpy(file_data.data() + levels[i].Offset, level_data[i].data(), levels[i].Size);
+        }
+
+        std::ofstream file(cache_filename, std::ios::binary | std::ios::trunc);
+        file.write((const char*)file_data.data(), file_data.size());
+        return (bool)file;
+    }
+
+    //open the cache for a source image, (re)building it first if it's missing or was built from different contents
+    inline const Header* open(std::string source_filename, VirtualFile& cache_file, bool* rebuilt = NULL) {
+        if (rebuilt) {
+            *rebuilt = false;
+        }
+        VirtualFile source_file = VirtualFileSystem::getDefault().read(source_filename);
+        if (!source_file.isOpen()) {
+            return NULL;
+        }
+        uint64_t source_hash = hash(source_file.getData(), source_file.getSize());
+
+        std::string cache_filename = getCachePath(source_filename);
+        cache_file = VirtualFileSystem::getDefault().read(cache_filename);
+        if (cache_file.isOpen()) {
+            const Header* header = validate(cache_file.getData(), cache_file.getSize(), source_hash);
+            if (header) {
+                return header;
+            }
+            cache_file.close();
+        }
+
+        if (!build(source_file.getData(), source_file.getSize(), source_hash, cache_filename)) {
+            return NULL;
+        }
+        cache_file = VirtualFile(MappedFile(cache_filename)); //straight from disk, a package may hold the stale copy
+        if (!cache_file.isOpen()) {
+            return NULL;
+        }
+        if (rebuilt) {
+            *rebuilt = true;
+        }
+        return validate(cache_file.getData(), cache_file.getSize(), source_hash);
+    }
+}
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <algorithm>
+
+#include <glad/glad.h>
+
+#include "texture_cache.h"
+#include "virtual_file_system.h"
+
+class TextureLoader { //maps (building if needed) texture caches on worker threads, uploads them on the GL thread through pixel buffer objects
+    struct Job {
+        GLuint Texture;
+        std::string Filename;
+        VirtualFile Cache;
+        const TextureCache::Header* Header; //NULL until loaded (or if loading failed)
+        int Layer; //-1 for a GL_TEXTURE_2D, otherwise the GL_TEXTURE_2D_ARRAY layer to fill
+        int Size; //width and height of the array's layers
+        std::vector<unsigned char> Resampled; //array layers only, rgba mip chain at Size, levels back to back
+        uint32_t Generation; //array layers only, the job is dropped once a later loadLayer() targets the same layer
+    };
+
+    std::vector<std::thread> Workers;
+    std::mutex Mutex;
+    std::condition_variable WorkAvailable;
+    std::deque<Job> Pending; //waiting to be decoded
+    std::deque<Job> Decoded; //waiting to be uploaded
+    int InFlight; //requested but not yet uploaded
+    bool Stopping;
+    std::unordered_map<uint64_t, uint32_t> LayerGenerations; //latest job for each array layer, keyed by getLayerKey()
+    uint32_t NextGeneration;
+
+    std::vector<GLuint> PixelBuffers; //reused between uploads
+    int NextPixelBuffer;
+
+public:
+    static const int PixelBufferCount = 2;
+
+    TextureLoader(unsigned int thread_count = std::thread::hardware_concurrency()) {
+        InFlight = 0;
+        Stopping = false;
+        NextGeneration = 0;
+        NextPixelBuffer = 0;
+        for (unsigned int i = 0; i < std::max(1u, thread_count); i++) {
+            Workers.push_back(std::thread(&TextureLoader::work, this));
+        }
+    }
+
+    ~TextureLoader() {
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            Stopping = true;
+        }
+        WorkAvailable.notify_all();
+        for (int i = 0; i < Workers.size(); i++) {
+            Workers[i].join();
+        }
+        if (!PixelBuffers.empty()) {
+            glDeleteBuffers((GLsizei)PixelBuffers.size(), PixelBuffers.data());
+        }
+    }
+
+    //create a texture showing a 1x1 placeholder and queue the real image for loading. must be called on the GL thread
+    GLuint load(std::string filename) {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+
+        //set texture settings
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT); //set texture wrapping setting, for 2D textures, in X(S) and Y(T) axes, to mirrored repeating
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); //bilinear interpolation when magnifying textures to produce pixel color
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); //trilinear interpolation (using mipmaps) when minifying textures to produce pixel color
+
+        unsigned char placeholder[4] = { 128, 128, 128, 255 }; //a single mip level of 1x1 is a complete texture
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            Pending.push_back({ texture, filename, VirtualFile(), NULL, -1, 0, {}, 0 });
+            InFlight++;
+        }
+        WorkAvailable.notify_one();
+        return texture;
+    }
+
+    //queue an image for resampling to size x size rgba and uploading into a layer of array, which must already have storage for
+    //every level down to 1x1 (see TextureArrayManager). replaces any earlier image queued for the same layer, even one already decoding:
+    //workers finish in any order, so otherwise a reused layer could end up with the image it held before
+    void loadLayer(GLuint array, int layer, int size, std::string filename) {
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            uint32_t generation = ++NextGeneration;
+            LayerGenerations[getLayerKey(array, layer)] = generation;
+            Pending.push_back({ array, filename, VirtualFile(), NULL, layer, size, {}, generation });
+            InFlight++;
+        }
+        WorkAvailable.notify_one();
+    }
+
+    //drop every layer job still queued for array, call before deleting it so none of them upload into a deleted (or recycled) name
+    void cancelLayers(GLuint array) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        for (auto i = LayerGenerations.begin(); i != LayerGenerations.end();) {
+            i = (GLuint)(i->first >> 32) == array ? LayerGenerations.erase(i) : std::next(i);
+        }
+    }
+
+    static int getLevelCount(int size) { //mip levels of a size x size texture, down to 1x1
+        int count = 1;
+        while (size > 1) {
+            size /= 2;
+            count++;
+        }
+        return count;
+    }
+
+    //upload loaded images, at most byte_budget bytes per call (always at least one image) to avoid frame hitches. must be called on the GL thread.
+    //returns the number of bytes uploaded
+    size_t update(size_t byte_budget = 16 << 20) {
+        if (PixelBuffers.empty()) {
+            PixelBuffers.resize(PixelBufferCount);
+            glGenBuffers(PixelBufferCount, PixelBuffers.data());
+        }
+
+        size_t uploaded = 0;
+        while (uploaded == 0 || uploaded < byte_budget) {
+            Job job;
+            {
+                std::lock_guard<std::mutex> lock(Mutex);
+                if (Decoded.empty()) {
+                    break;
+                }
+                job = std::move(Decoded.front());
+                Decoded.pop_front();
+                if (!isCurrent(job)) { //replaced or cancelled while it was decoding
+                    InFlight--;
+                    continue;
+                }
+            }
+            if (job.Header) {
+                uploaded += upload(job);
+            }
+            else {
+                std::cout << "Failed to load texture " << job.Filename << std::endl;
+            }
+            std::lock_guard<std::mutex> lock(Mutex);
+            InFlight--;
+        }
+        return uploaded;
+    }
+
+    bool isAllResident() { //every requested texture has been uploaded (or has failed)
+        std::lock_guard<std::mutex> lock(Mutex);
+        return InFlight == 0;
+    }
+
+private:
+    static uint64_t getLayerKey(GLuint array, int layer) {
+        return ((uint64_t)array << 32) | (uint32_t)layer;
+    }
+
+    bool isCurrent(const Job& job) { //Mutex must be held
+        if (job.Layer < 0) {
+            return true;
+        }
+        auto latest = LayerGenerations.find(getLayerKey(job.Texture, job.Layer));
+        return latest != LayerGenerations.end() && latest->second == job.Generation;
+    }
+
+    void work() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(Mutex);
+                WorkAvailable.wait(lock, [this]() { return Stopping || !Pending.empty(); });
+                if (Stopping) {
+                    return;
+                }
+                job = std::move(Pending.front());
+                Pending.pop_front();
+                if (!isCurrent(job)) { //no point decoding it, update() drops it
+                    Decoded.push_back(std::move(job));
+                    continue;
+                }
+            }
+            job.Header = TextureCache::open(job.Filename, job.Cache); //only decodes (and builds mips) when the cache is missing or stale
+            if (job.Header && job.Layer >= 0) {
+                resampleLayer(job);
+            }
+            std::lock_guard<std::mutex> lock(Mutex);
+            Decoded.push_back(std::move(job));
+        }
+    }
+
+    void resampleLayer(Job& job) { //fit the cached image to the array's layer size, then rebuild the mips from that
+        const TextureCache::Header* header = job.Header;
+        const TextureCache::Level* levels = TextureCache::getLevels(header);
+        uint32_t source = 0; //smallest level still at least the layer size, so resampling never shrinks by 2x or more
+        while (source + 1 < header->LevelCount && levels[source + 1].Width >= (uint32_t)job.Size && levels[source + 1].Height >= (uint32_t)job.Size) {
+            source++;
+        }
+
+        size_t total = 0;
+        for (int size = job.Size; size >= 1; size /= 2) {
+            total += (size_t)size * size * 4;
+        }
+        job.Resampled.resize(total);
+        unsigned char* level = job.Resampled.data();
+        TextureCache::resample(job.Cache.getData() + levels[source].Offset, levels[source].Width, levels[source].Height, header->Channels, level, job.Size);
+        for (int size = job.Size; size > 1; size /= 2) {
+            unsigned char* next = level + (size_t)size * size * 4;
+            TextureCache::downsample(level, size, size, 4, next, size / 2, size / 2);
+            level = next;
+        }
+        job.Cache.close(); //everything needed is in Resampled now
+    }
+
+    size_t upload(Job& job) {
+        if (job.Layer >= 0) {
+            return uploadLayer(job);
+        }
+        const TextureCache::Header* header = job.Header;
+        const TextureCache::Level* levels = TextureCache::getLevels(header);
+        GLenum format = header->Channels == 1 ? GL_RED : header->Channels == 2 ? GL_RG : header->Channels == 3 ? GL_RGB : GL_RGBA;
+
+        //levels are stored back to back, so the whole chain goes into a pixel buffer with one copy.
+        //glTexImage2D can then return without reading client memory, the driver transfers from the buffer asynchronously
+        uint64_t base = levels[0].Offset;
+        size_t size = (size_t)(levels[header->LevelCount - 1].Offset + levels[header->LevelCount - 1].Size - base);
+        const unsigned char* source = job.Cache.getData() + base;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PixelBuffers[NextPixelBuffer]);
+        NextPixelBuffer = (NextPixelBuffer + 1) % PixelBufferCount;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW); //orphan, so we never wait on the previous upload from this buffer
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped) {
+            memcpy(mapped, source, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            source = NULL; //level offsets are now relative to the bound pixel buffer
+        }
+        else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); //fall back to uploading straight from the mapping
+        }
+
+        glBindTexture(GL_TEXTURE_2D, job.Texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); //rows of rgb images aren't necessarily 4 byte aligned
+        for (uint32_t i = 0; i < header->LevelCount; i++) { //precomputed mips, no glGenerateMipmap
+            glTexImage2D(GL_TEXTURE_2D, i, format, levels[i].Width, levels[i].Height, 0, format, GL_UNSIGNED_BYTE, (const void*)((uintptr_t)source + (levels[i].Offset - base)));
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->LevelCount - 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return size;
+    }
+
+    size_t uploadLayer(Job& job) {
+        size_t size = job.Resampled.size();
+        const unsigned char* source = job.Resampled.data();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PixelBuffers[NextPixelBuffer]);
+        NextPixelBuffer = (NextPixelBuffer + 1) % PixelBufferCount;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped) {
+            memcpy(mapped, source, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            source = NULL;
+        }
+        else {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, job.Texture);
+        size_t offset = 0;
+        int level = 0;
+        for (int level_size = job.Size; level_size >= 1; level_size /= 2) {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, job.Layer, level_size, level_size, 1, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)((uintptr_t)source + offset));
+            offset += (size_t)level_size * level_size * 4;
+            level++;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return size;
+    }
+};
@@ -0,0 +1,379 @@
+#pragma once
+
+/*
+batch model matrix construction from structure-of-arrays inputs, 4 (SSE4.1) or 8 (AVX) objects at a time:
+
+    computeEuler:     same result as Transform::getTransformMatrix() -> rotate Z, X, Y then translate then scale
+    computeAxisAngle: translate(translation) * rotate(angle, axis), with one angle shared by the whole batch
+
+the instruction set is picked at runtime from what the CPU supports, and large batches are split into jobs
+*/
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <SDL.h>
+
+#include <glm.hpp>
+
+#include "job_system.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_BATCH_X86
+#include <immintrin.h>
+#endif
+
+#if defined(TRANSFORM_BATCH_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TRANSFORM_BATCH_SSE41 __attribute__((target("sse4.1")))
+#define TRANSFORM_BATCH_AVX __attribute__((target("avx")))
+#else
+#define TRANSFORM_BATCH_SSE41 //msvc allows any intrinsic without a matching /arch flag
+#define TRANSFORM_BATCH_AVX
+#endif
+
+namespace TransformBatch {
+    const size_t MinObjectsPerJob = 4096; //below this, scheduling a job costs more than it saves
+
+    enum Level {
+        LevelScalar,
+        LevelSSE41,
+        LevelAVX,
+    };
+
+    inline const char* getLevelName(Level level) {
+        switch (level) {
+        case LevelSSE41: return "sse4.1";
+        case LevelAVX: return "avx";
+        default: return "scalar";
+        }
+    }
+
+    inline Level detectLevel() { //best instruction set supported by this CPU (and OS, SDL checks both)
+        static Level level = []() {
+#ifdef TRANSFORM_BATCH_X86
+            if (SDL_HasAVX()) {
+                return LevelAVX;
+            }
+            if (SDL_HasSSE41()) {
+                return LevelSSE41;
+            }
+#endif
+            return LevelScalar;
+        }();
+        return level;
+    }
+
+    struct Vec3Array { //structure of arrays, one vector per component
+        std::vector<float> X;
+        std::vector<float> Y;
+        std::vector<float> Z;
+
+        void resize(size_t count, float value = 0.0f) {
+            X.resize(count, value);
+            Y.resize(count, value);
+            Z.resize(count, value);
+        }
+
+        size_t size() const {
+            return X.size();
+        }
+
+        void set(size_t i, glm::vec3 v) {
+            X[i] = v.x;
+            Y[i] = v.y;
+            Z[i] = v.z;
+        }
+
+        glm::vec3 get(size_t i) const {
+            return glm::vec3(X[i], Y[i], Z[i]);
+        }
+    };
+
+    /******************************************************
+    * scalar kernels (reference and fallback)
+    ******************************************************/
+
+    inline void eulerScalar(const Vec3Array& translations, const Vec3Array& rotations, const Vec3Array& scales, glm::mat4* out, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            float cx = cosf(rotations.X[i]), sx = sinf(rotations.X[i]);
+            float cy = cosf(rotations.Y[i]), sy = sinf(rotations.Y[i]);
+            float cz = cosf(rotations.Z[i]), sz = sinf(rotations.Z[i]);
+
+            //columns of Rz * Rx * Ry
+            glm::vec3 r0 = glm::vec3(cy * cz - sy * sz * sx, cy * sz + sy * cz * sx, -sy * cx);
+            glm::vec3 r1 = glm::vec3(-sz * cx, cz * cx, sx);
+            glm::vec3 r2 = glm::vec3(sy * cz + cy * sz * sx, sy * sz - cy * cz * sx, cy * cx);
+
+            glm::vec3 t = r0 * translations.X[i] + r1 * translations.Y[i] + r2 * translations.Z[i];
+            out[i][0] = glm::vec4(r0 * scales.X[i], 0.0f);
+            out[i][1] = glm::vec4(r1 * scales.Y[i], 0.0f);
+            out[i][2] = glm::vec4(r2 * scales.Z[i], 0.0f);
+            out[i][3] = glm::vec4(t, 1.0f);
+        }
+    }
+
+    inline void axisAngleScalar(const Vec3Array& translations, const Vec3Array& axes, float c, float s, glm::mat4* out, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            glm::vec3 axis = glm::vec3(axes.X[i], axes.Y[i], axes.Z[i]);
+            axis = axis / sqrtf(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+            glm::vec3 temp = axis * (1.0f - c);
+
+            out[i][0] = glm::vec4(c + temp.x * axis.x, temp.x * axis.y + s * axis.z, temp.x * axis.z - s * axis.y, 0.0f);
+            out[i][1] = glm::vec4(temp.y * axis.x - s * axis.z, c + temp.y * axis.y, temp.y * axis.z + s * axis.x, 0.0f);
+            out[i][2] = glm::vec4(temp.z * axis.x + s * axis.y, temp.z * axis.y - s * axis.x, c + temp.z * axis.z, 0.0f);
+            out[i][3] = glm::vec4(translations.X[i], translations.Y[i], translations.Z[i], 1.0f);
+        }
+    }
+
+#ifdef TRANSFORM_BATCH_X86
+    /******************************************************
+    * sse4.1 kernels, 4 objects per iteration
+    ******************************************************/
+
+    TRANSFORM_BATCH_SSE41 inline void sincos4(__m128 x, __m128& sin_out, __m128& cos_out) { //cephes style, reduce to [-pi/4, pi/4] then pick quadrant
+        __m128 j = _mm_round_ps(_mm_mul_ps(x, _mm_set1_ps(0.636619772f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(1.5703125f)));
+        r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(4.837512969970703125e-4f)));
+        r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(7.54978995489188216e-8f)));
+        __m128 q = _mm_sub_ps(j, _mm_mul_ps(_mm_floor_ps(_mm_mul_ps(j, _mm_set1_ps(0.25f))), _mm_set1_ps(4.0f))); //quadrant 0-3
+
+        __m128 r2 = _mm_mul_ps(r, r);
+        __m128 s = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(-1.9515295891e-4f)), _mm_set1_ps(8.3321608736e-3f));
+        s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(-1.6666654611e-1f));
+        s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+        __m128 c = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(2.443315711809948e-5f)), _mm_set1_ps(-1.388731625493765e-3f));
+        c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(4.166664568298827e-2f));
+        c = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(c, r2), r2), _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+        __m128 odd = _mm_or_ps(_mm_cmpeq_ps(q, _mm_set1_ps(1.0f)), _mm_cmpeq_ps(q, _mm_set1_ps(3.0f)));
+        __m128 sin_negative = _mm_cmpge_ps(q, _mm_set1_ps(2.0f));
+        __m128 cos_negative = _mm_or_ps(_mm_cmpeq_ps(q, _mm_set1_ps(1.0f)), _mm_cmpeq_ps(q, _mm_set1_ps(2.0f)));
+        __m128 sign = _mm_set1_ps(-0.0f);
+        sin_out = _mm_xor_ps(_mm_blendv_ps(s, c, odd), _mm_and_ps(sin_negative, sign));
+        cos_out = _mm_xor_ps(_mm_blendv_ps(c, s, odd), _mm_and_ps(cos_negative, sign));
+    }
+
+    TRANSFORM_BATCH_SSE41 inline void storeColumn4(glm::mat4* out, int column, __m128 x, __m128 y, __m128 z, __m128 w) { //transpose 4 objects' column from SoA to AoS
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _mm_storeu_ps(&out[0][column][0], x);
+        _mm_storeu_ps(&out[1][column][0], y);
+        _mm_storeu_ps(&out[2][column][0], z);
+        _mm_storeu_ps(&out[3][column][0], w);
+    }
+
+    TRANSFORM_BATCH_SSE41 inline size_t eulerSSE41(const Vec3Array& translations, const Vec3Array& rotations, const Vec3Array& scales, glm::mat4* out, size_t begin, size_t end) { //returns where it stopped, the remainder is left for the scalar kernel
+        size_t i = begin;
+        for (; i + 4 <= end; i += 4) {
+            __m128 sx, cx, sy, cy, sz, cz;
+            sincos4(_mm_loadu_ps(&rotations.X[i]), sx, cx);
+            sincos4(_mm_loadu_ps(&rotations.Y[i]), sy, cy);
+            sincos4(_mm_loadu_ps(&rotations.Z[i]), sz, cz);
+
+            __m128 sz_sx = _mm_mul_ps(sz, sx);
+            __m128 cz_sx = _mm_mul_ps(cz, sx);
+            __m128 r0x = _mm_sub_ps(_mm_mul_ps(cy, cz), _mm_mul_ps(sy, sz_sx));
+            __m128 r0y = _mm_add_ps(_mm_mul_ps(cy, sz), _mm_mul_ps(sy, cz_sx));
+            __m128 r0z = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sy, cx));
+            __m128 r1x = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sz, cx));
+            __m128 r1y = _mm_mul_ps(cz, cx);
+            __m128 r1z = sx;
+            __m128 r2x = _mm_add_ps(_mm_mul_ps(sy, cz), _mm_mul_ps(cy, sz_sx));
+            __m128 r2y = _mm_sub_ps(_mm_mul_ps(sy, sz), _mm_mul_ps(cy, cz_sx));
+            __m128 r2z = _mm_mul_ps(cy, cx);
+
+            __m128 tx = _mm_loadu_ps(&translations.X[i]);
+            __m128 ty = _mm_loadu_ps(&translations.Y[i]);
+            __m128 tz = _mm_loadu_ps(&translations.Z[i]);
+            __m128 scale_x = _mm_loadu_ps(&scales.X[i]);
+            __m128 scale_y = _mm_loadu_ps(&scales.Y[i]);
+            __m128 scale_z = _mm_loadu_ps(&scales.Z[i]);
+            __m128 zero = _mm_setzero_ps();
+
+            storeColumn4(out + i, 0, _mm_mul_ps(r0x, scale_x), _mm_mul_ps(r0y, scale_x), _mm_mul_ps(r0z, scale_x), zero);
+            storeColumn4(out + i, 1, _mm_mul_ps(r1x, scale_y), _mm_mul_ps(r1y, scale_y), _mm_mul_ps(r1z, scale_y), zero);
+            storeColumn4(out + i, 2, _mm_mul_ps(r2x, scale_z), _mm_mul_ps(r2y, scale_z), _mm_mul_ps(r2z, scale_z), zero);
+            storeColumn4(out + i, 3,
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0x, tx), _mm_mul_ps(r1x, ty)), _mm_mul_ps(r2x, tz)),
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0y, tx), _mm_mul_ps(r1y, ty)), _mm_mul_ps(r2y, tz)),
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0z, tx), _mm_mul_ps(r1z, ty)), _mm_mul_ps(r2z, tz)),
+                _mm_set1_ps(1.0f));
+        }
+        return i;
+    }
+
+    TRANSFORM_BATCH_SSE41 inline size_t axisAngleSSE41(const Vec3Array& translations, const Vec3Array& axes, float cos_angle, float sin_angle, glm::mat4* out, size_t begin, size_t end) {
+        __m128 c = _mm_set1_ps(cos_angle);
+        __m128 s = _mm_set1_ps(sin_angle);
+        __m128 one_minus_c = _mm_set1_ps(1.0f - cos_angle);
+        __m128 zero = _mm_setzero_ps();
+        size_t i = begin;
+        for (; i + 4 <= end; i += 4) {
+            __m128 ax = _mm_loadu_ps(&axes.X[i]);
+            __m128 ay = _mm_loadu_ps(&axes.Y[i]);
+            __m128 az = _mm_loadu_ps(&axes.Z[i]);
+            __m128 inv_length = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ax), _mm_mul_ps(ay, ay)), _mm_mul_ps(az, az))));
+            ax = _mm_mul_ps(ax, inv_length);
+            ay = _mm_mul_ps(ay, inv_length);
+            az = _mm_mul_ps(az, inv_length);
+            __m128 temp_x = _mm_mul_ps(ax, one_minus_c);
+            __m128 temp_y = _mm_mul_ps(ay, one_minus_c);
+            __m128 temp_z = _mm_mul_ps(az, one_minus_c);
+
+            storeColumn4(out + i, 0, _mm_add_ps(c, _mm_mul_ps(temp_x, ax)), _mm_add_ps(_mm_mul_ps(temp_x, ay), _mm_mul_ps(s, az)), _mm_sub_ps(_mm_mul_ps(temp_x, az), _mm_mul_ps(s, ay)), zero);
+            storeColumn4(out + i, 1, _mm_sub_ps(_mm_mul_ps(temp_y, ax), _mm_mul_ps(s, az)), _mm_add_ps(c, _mm_mul_ps(temp_y, ay)), _mm_add_ps(_mm_mul_ps(temp_y, az), _mm_mul_ps(s, ax)), zero);
+            storeColumn4(out + i, 2, _mm_add_ps(_mm_mul_ps(temp_z, ax), _mm_mul_ps(s, ay)), _mm_sub_ps(_mm_mul_ps(temp_z, ay), _mm_mul_ps(s, ax)), _mm_add_ps(c, _mm_mul_ps(temp_z, az)), zero);
+            storeColumn4(out + i, 3, _mm_loadu_ps(&translations.X[i]), _mm_loadu_ps(&translations.Y[i]), _mm_loadu_ps(&translations.Z[i]), _mm_set1_ps(1.0f));
+        }
+        return i;
+    }
+
+    /******************************************************
+    * avx kernels, 8 objects per iteration
+    ******************************************************/
+
+    TRANSFORM_BATCH_AVX inline void sincos8(__m256 x, __m256& sin_out, __m256& cos_out) {
+        __m256 j = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(0.636619772f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(j, _mm256_set1_ps(1.5703125f)));
+        r = _mm256_sub_ps(r, _mm256_mul_ps(j, _mm256_set1_ps(4.837512969970703125e-4f)));
+        r = _mm256_sub_ps(r, _mm256_mul_ps(j, _mm256_set1_ps(7.54978995489188216e-8f)));
+        __m256 q = _mm256_sub_ps(j, _mm256_mul_ps(_mm256_floor_ps(_mm256_mul_ps(j, _mm256_set1_ps(0.25f))), _mm256_set1_ps(4.0f)));
+
+        __m256 r2 = _mm256_mul_ps(r, r);
+        __m256 s = _mm256_add_ps(_mm256_mul_ps(r2, _mm256_set1_ps(-1.9515295891e-4f)), _mm256_set1_ps(8.3321608736e-3f));
+        s = _mm256_add_ps(_mm256_mul_ps(s, r2), _mm256_set1_ps(-1.6666654611e-1f));
+        s = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s, r2), r), r);
+        __m256 c = _mm256_add_ps(_mm256_mul_ps(r2, _mm256_set1_ps(2.443315711809948e-5f)), _mm256_set1_ps(-1.388731625493765e-3f));
+        c = _mm256_add_ps(_mm256_mul_ps(c, r2), _mm256_set1_ps(4.166664568298827e-2f));
+        c = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(c, r2), r2), _mm256_mul_ps(r2, _mm256_set1_ps(0.5f))), _mm256_set1_ps(1.0f));
+
+        __m256 odd = _mm256_or_ps(_mm256_cmp_ps(q, _mm256_set1_ps(1.0f), _CMP_EQ_OQ), _mm256_cmp_ps(q, _mm256_set1_ps(3.0f), _CMP_EQ_OQ));
+        __m256 sin_negative = _mm256_cmp_ps(q, _mm256_set1_ps(2.0f), _CMP_GE_OQ);
+        __m256 cos_negative = _mm256_or_ps(_mm256_cmp_ps(q, _mm256_set1_ps(1.0f), _CMP_EQ_OQ), _mm256_cmp_ps(q, _mm256_set1_ps(2.0f), _CMP_EQ_OQ));
+        __m256 sign = _mm256_set1_ps(-0.0f);
+        sin_out = _mm256_xor_ps(_mm256_blendv_ps(s, c, odd), _mm256_and_ps(sin_negative, sign));
+        cos_out = _mm256_xor_ps(_mm256_blendv_ps(c, s, odd), _mm256_and_ps(cos_negative, sign));
+    }
+
+    TRANSFORM_BATCH_AVX inline void storeColumn8(glm::mat4* out, int column, __m256 x, __m256 y, __m256 z, __m256 w) { //transpose 8 objects' column from SoA to AoS
+        __m256 t0 = _mm256_unpacklo_ps(x, y);
+        __m256 t1 = _mm256_unpackhi_ps(x, y);
+        __m256 t2 = _mm256_unpacklo_ps(z, w);
+        __m256 t3 = _mm256_unpackhi_ps(z, w);
+        __m256 o04 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)); //objects 0 (low half) and 4 (high half)
+        __m256 o15 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 o26 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 o37 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        _mm_storeu_ps(&out[0][column][0], _mm256_castps256_ps128(o04));
+        _mm_storeu_ps(&out[1][column][0], _mm256_castps256_ps128(o15));
+        _mm_storeu_ps(&out[2][column][0], _mm256_castps256_ps128(o26));
+        _mm_storeu_ps(&out[3][column][0], _mm256_castps256_ps128(o37));
+        _mm_storeu_ps(&out[4][column][0], _mm256_extractf128_ps(o04, 1));
+        _mm_storeu_ps(&out[5][column][0], _mm256_extractf128_ps(o15, 1));
+        _mm_storeu_ps(&out[6][column][0], _mm256_extractf128_ps(o26, 1));
+        _mm_storeu_ps(&out[7][column][0], _mm256_extractf128_ps(o37, 1));
+    }
+
+    TRANSFORM_BATCH_AVX inline size_t eulerAVX(const Vec3Array& translations, const Vec3Array& rotations, const Vec3Array& scales, glm::mat4* out, size_t begin, size_t end) {
+        size_t i = begin;
+        for (; i + 8 <= end; i += 8) {
+            __m256 sx, cx, sy, cy, sz, cz;
+            sincos8(_mm256_loadu_ps(&rotations.X[i]), sx, cx);
+            sincos8(_mm256_loadu_ps(&rotations.Y[i]), sy, cy);
+            sincos8(_mm256_loadu_ps(&rotations.Z[i]), sz, cz);
+
+            __m256 sz_sx = _mm256_mul_ps(sz, sx);
+            __m256 cz_sx = _mm256_mul_ps(cz, sx);
+            __m256 r0x = _mm256_sub_ps(_mm256_mul_ps(cy, cz), _mm256_mul_ps(sy, sz_sx));
+            __m256 r0y = _mm256_add_ps(_mm256_mul_ps(cy, sz), _mm256_mul_ps(sy, cz_sx));
+            __m256 r0z = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(sy, cx));
+            __m256 r1x = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(sz, cx));
+            __m256 r1y = _mm256_mul_ps(cz, cx);
+            __m256 r1z = sx;
+            __m256 r2x = _mm256_add_ps(_mm256_mul_ps(sy, cz), _mm256_mul_ps(cy, sz_sx));
+            __m256 r2y = _mm256_sub_ps(_mm256_mul_ps(sy, sz), _mm256_mul_ps(cy, cz_sx));
+            __m256 r2z = _mm256_mul_ps(cy, cx);
+
+            __m256 tx = _mm256_loadu_ps(&translations.X[i]);
+            __m256 ty = _mm256_loadu_ps(&translations.Y[i]);
+            __m256 tz = _mm256_loadu_ps(&translations.Z[i]);
+            __m256 scale_x = _mm256_loadu_ps(&scales.X[i]);
+            __m256 scale_y = _mm256_loadu_ps(&scales.Y[i]);
+            __m256 scale_z = _mm256_loadu_ps(&scales.Z[i]);
+            __m256 zero = _mm256_setzero_ps();
+
+            storeColumn8(out + i, 0, _mm256_mul_ps(r0x, scale_x), _mm256_mul_ps(r0y, scale_x), _mm256_mul_ps(r0z, scale_x), zero);
+            storeColumn8(out + i, 1, _mm256_mul_ps(r1x, scale_y), _mm256_mul_ps(r1y, scale_y), _mm256_mul_ps(r1z, scale_y), zero);
+            storeColumn8(out + i, 2, _mm256_mul_ps(r2x, scale_z), _mm256_mul_ps(r2y, scale_z), _mm256_mul_ps(r2z, scale_z), zero);
+            storeColumn8(out + i, 3,
+                _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r0x, tx), _mm256_mul_ps(r1x, ty)), _mm256_mul_ps(r2x, tz)),
+                _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r0y, tx), _mm256_mul_ps(r1y, ty)), _mm256_mul_ps(r2y, tz)),
+                _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r0z, tx), _mm256_mul_ps(r1z, ty)), _mm256_mul_ps(r2z, tz)),
+                _mm256_set1_ps(1.0f));
+        }
+        return i;
+    }
+
+    TRANSFORM_BATCH_AVX inline size_t axisAngleAVX(const Vec3Array& translations, const Vec3Array& axes, float cos_angle, float sin_angle, glm::mat4* out, size_t begin, size_t end) {
+        __m256 c = _mm256_set1_ps(cos_angle);
+        __m256 s = _mm256_set1_ps(sin_angle);
+        __m256 one_minus_c = _mm256_set1_ps(1.0f - cos_angle);
+        __m256 zero = _mm256_setzero_ps();
+        size_t i = begin;
+        for (; i + 8 <= end; i += 8) {
+            __m256 ax = _mm256_loadu_ps(&axes.X[i]);
+            __m256 ay = _mm256_loadu_ps(&axes.Y[i]);
+            __m256 az = _mm256_loadu_ps(&axes.Z[i]);
+            __m256 inv_length = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, ax), _mm256_mul_ps(ay, ay)), _mm256_mul_ps(az, az))));
+            ax = _mm256_mul_ps(ax, inv_length);
+            ay = _mm256_mul_ps(ay, inv_length);
+            az = _mm256_mul_ps(az, inv_length);
+            __m256 temp_x = _mm256_mul_ps(ax, one_minus_c);
+            __m256 temp_y = _mm256_mul_ps(ay, one_minus_c);
+            __m256 temp_z = _mm256_mul_ps(az, one_minus_c);
+
+            storeColumn8(out + i, 0, _mm256_add_ps(c, _mm256_mul_ps(temp_x, ax)), _mm256_add_ps(_mm256_mul_ps(temp_x, ay), _mm256_mul_ps(s, az)), _mm256_sub_ps(_mm256_mul_ps(temp_x, az), _mm256_mul_ps(s, ay)), zero);
+            storeColumn8(out + i, 1, _mm256_sub_ps(_mm256_mul_ps(temp_y, ax), _mm256_mul_ps(s, az)), _mm256_add_ps(c, _mm256_mul_ps(temp_y, ay)), _mm256_add_ps(_mm256_mul_ps(temp_y, az), _mm256_mul_ps(s, ax)), zero);
+            storeColumn8(out + i, 2, _mm256_add_ps(_mm256_mul_ps(temp_z, ax), _mm256_mul_ps(s, ay)), _mm256_sub_ps(_mm256_mul_ps(temp_z, ay), _mm256_mul_ps(s, ax)), _mm256_add_ps(c, _mm256_mul_ps(temp_z, az)), zero);
+            storeColumn8(out + i, 3, _mm256_loadu_ps(&translations.X[i]), _mm256_loadu_ps(&translations.Y[i]), _mm256_loadu_ps(&translations.Z[i]), _mm256_set1_ps(1.0f));
+        }
+        return i;
+    }
+#endif
+
+    /******************************************************
+    * dispatch
+    ******************************************************/
+
+    //Transform::getTransformMatrix() for every object, rotations are euler angles
+    inline void computeEuler(const Vec3Array& translations, const Vec3Array& rotations, const Vec3Array& scales, glm::mat4* out, Level level = detectLevel(), JobSystem& jobs = JobSystem::getDefault()) {
+        jobs.parallelFor(translations.size(), MinObjectsPerJob, [&](size_t begin, size_t end) {
+#ifdef TRANSFORM_BATCH_X86
+            if (level == LevelAVX) {
+                begin = eulerAVX(translations, rotations, scales, out, begin, end);
+            }
+            else if (level == LevelSSE41) {
+                begin = eulerSSE41(translations, rotations, scales, out, begin, end);
+            }
+#endif
+            eulerScalar(translations, rotations, scales, out, begin, end);
+        });
+    }
+
+    //translate(translations[i]) * rotate(angle, axes[i]) for every object, axes needn't be normalized
+    inline void computeAxisAngle(const Vec3Array& translations, const Vec3Array& axes, float angle, glm::mat4* out, Level level = detectLevel(), JobSystem& jobs = JobSystem::getDefault()) {
+        float c = cosf(angle);
+        float s = sinf(angle);
+        jobs.parallelFor(translations.size(), MinObjectsPerJob, [&](size_t begin, size_t end) {
+#ifdef TRANSFORM_BATCH_X86
+            if (level == LevelAVX) {
+                begin = axisAngleAVX(translations, axes, c, s, out, begin, end);
+            }
+            else if (level == LevelSSE41) {
+                begin = axisAngleSSE41(translations, axes, c, s, out, begin, end);
+            }
+#endif
+            axisAngleScalar(translations, axes, c, s, out, begin, end);
+        });
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+
+//single producer, single consumer, lock free. the writer always has a slot to fill and the reader always has a complete value to read,
+//neither ever waits on the other. values the reader doesn't get round to reading are overwritten by newer ones
+template<typename T>
+class TripleBuffer {
+    static const int FreshBit = 4; //set in Middle when the writer has published since the reader last took it
+
+    T Slots[3];
+    std::atomic<int> Middle; //index of the slot passed between the two sides, plus FreshBit
+    int Back; //owned by the writer
+    int Front; //owned by the reader
+
+public:
+    TripleBuffer() {
+        Front = 0;
+        Middle.store(1);
+        Back = 2;
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    T& getBack() { //writer: the slot to fill before publish()
+        return Slots[Back];
+    }
+
+    void publish() { //writer: swap the filled slot into the middle
+        Back = Middle.exchange(Back | FreshBit, std::memory_order_acq_rel) & ~FreshBit;
+    }
+
+    bool update() { //reader: take the latest published value if there is one, returns whether the front changed
+        if (!(Middle.load(std::memory_order_relaxed) & FreshBit)) {
+            return false;
+        }
+        Front = Middle.exchange(Front, std::memory_order_acq_rel) & ~FreshBit;
+        return true;
+    }
+
+    const T& getFront() { //reader: the latest value taken by update()
+        return Slots[Front];
+    }
+};
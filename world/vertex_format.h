@@ -0,0 +1,280 @@
+#pragma once
+
+/*
+compact vertex encodings, picked per attribute when a mesh is converted:
+
+    positions   float (12 bytes) or unorm16 relative to the mesh's bounding box (6 bytes, padded to 8). the box is undone by
+                MeshFile::Dequantization::PositionScale/Bias, which the renderer folds into each model matrix (see foldDequantization)
+    tex coords  float (8 bytes), half float (4 bytes) or unorm16 relative to the coordinates' range (4 bytes, undone by
+                Dequantization::TexCoordScale/Bias, applied in the vertex shader)
+
+attributes stay 4 byte aligned. every encoding is described by the mesh's AttributeDesc layout, so nothing downstream hardcodes offsets
+*/
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include <glad/glad.h>
+
+#include <glm.hpp>
+
+#include "mesh_file.h"
+
+namespace VertexFormat {
+    enum PositionEncoding {
+        PositionFloat,
+        PositionUnorm16,
+    };
+
+    enum TexCoordEncoding {
+        TexCoordFloat,
+        TexCoordHalf,
+        TexCoordUnorm16,
+    };
+
+    struct Format {
+        PositionEncoding Position;
+        TexCoordEncoding TexCoord;
+    };
+
+    inline Format getFullFormat() {
+        return { PositionFloat, TexCoordFloat };
+    }
+
+    inline Format getCompactFormat() { //12 bytes a vertex instead of 20
+        return { PositionUnorm16, TexCoordHalf };
+    }
+
+    struct Encoded {
+        std::vector<MeshFile::AttributeDesc> Layout;
+        uint32_t Stride;
+        std::vector<unsigned char> Vertices;
+        MeshFile::Dequantization Dequantize;
+    };
+
+    inline uint16_t floatToHalf(float value) { //round to nearest even, overflow to infinity, underflow through denormals to 0
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+        uint32_t magnitude = bits & 0x7FFFFFFF;
+        if (magnitude >= 0x7F800000) { //inf or nan
+            return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0);
+        }
+        if (magnitude >= 0x477FF000) { //rounds to above the largest half (65504)
+            return sign | 0x7C00;
+        }
+        if (magnitude < 0x38800000) { //below the smallest normal half, shift the implicit 1 into a denormal
+            if (magnitude < 0x33000000) {
+                return sign;
+            }
+            uint32_t exponent = magnitude >> 23;
+            uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+            uint32_t shift = 126 - exponent;
+            uint32_t half = mantissa >> shift;
+            uint32_t remainder = mantissa & ((1u << shift) - 1);
+            uint32_t midpoint = 1u << (shift - 1);
+            if (remainder > midpoint || (remainder == midpoint && (half & 1))) {
+                half++;
+            }
+            return sign | (uint16_t)half;
+        }
+        uint32_t half = (magnitude - 0x38000000) >> 13; //rebias exponent 127 -> 15
+        uint32_t remainder = magnitude & 0x1FFF;
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+            half++; //may carry into the exponent, which is still correct
+        }
+        return sign | (uint16_t)half;
+    }
+
+    inline float halfToFloat(uint16_t half) {
+        uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+        uint32_t exponent = (half >> 10) & 0x1F;
+        uint32_t mantissa = half & 0x3FF;
+        uint32_t bits;
+        if (exponent == 0x1F) {
+            bits = sign | 0x7F800000 | (mantissa << 13);
+        }
+        else if (exponent != 0) {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        else if (mantissa == 0) {
+            bits = sign;
+        }
+        else { //denormal, normalize it
+            exponent = 113;
+            while (!(mantissa & 0x400)) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+        }
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    inline uint16_t floatToUnorm16(float value) { //value in [0, 1]
+        return (uint16_t)(std::min(1.0f, std::max(0.0f, value)) * 65535.0f + 0.5f);
+    }
+
+    //read components of one attribute as floats (normalized if the layout says so), without any scale/bias
+    inline void decodeAttribute(const MeshFile::AttributeDesc& attribute, const unsigned char* vertex, float* out) {
+        const unsigned char* data = vertex + attribute.Offset;
+        for (uint32_t c = 0; c < attribute.Components; c++) {
+            switch (attribute.Type) {
+            case GL_FLOAT:
+                memcpy(&out[c], data + c * sizeof(float), sizeof(float));
+                break;
+            case GL_HALF_FLOAT: {
+                uint16_t half;
+                memcpy(&half, data + c * sizeof(uint16_t), sizeof(uint16_t));
+                out[c] = halfToFloat(half);
+                break;
+            }
+            case GL_UNSIGNED_SHORT: {
+                uint16_t value;
+                memcpy(&value, data + c * sizeof(uint16_t), sizeof(uint16_t));
+                out[c] = attribute.Normalized ? value / 65535.0f : (float)value;
+                break;
+            }
+            default:
+                out[c] = 0.0f;
+            }
+        }
+    }
+
+    inline const MeshFile::AttributeDesc* findAttribute(const std::vector<MeshFile::AttributeDesc>& layout, uint32_t semantic) {
+        for (size_t i = 0; i < layout.size(); i++) {
+            if (layout[i].Semantic == semantic) {
+                return &layout[i];
+            }
+        }
+        return NULL;
+    }
+
+    //re-encode vertices described by layout into format. attributes other than position and tex coord are copied as they are
+    inline Encoded encode(const std::vector<MeshFile::AttributeDesc>& layout, uint32_t stride, const unsigned char* vertices, size_t vertex_count, Format format) {
+        Encoded encoded = {};
+        encoded.Dequantize = MeshFile::getIdentityDequantization();
+        MeshFile::Dequantization& dequantize = encoded.Dequantize;
+
+        //value ranges, for the unorm encodings
+        glm::vec3 position_min = glm::vec3(INFINITY);
+        glm::vec3 position_max = glm::vec3(-INFINITY);
+        glm::vec2 tex_coord_min = glm::vec2(INFINITY, INFINITY);
+        glm::vec2 tex_coord_max = glm::vec2(-INFINITY, -INFINITY);
+        const MeshFile::AttributeDesc* position = findAttribute(layout, MeshFile::SemanticPosition);
+        const MeshFile::AttributeDesc* tex_coord = findAttribute(layout, MeshFile::SemanticTexCoord);
+        for (size_t i = 0; i < vertex_count; i++) {
+            float values[4] = {};
+            if (position) {
+                decodeAttribute(*position, vertices + i * stride, values);
+                position_min = glm::min(position_min, glm::vec3(values[0], values[1], values[2]));
+                position_max = glm::max(position_max, glm::vec3(values[0], values[1], values[2]));
+            }
+            if (tex_coord) {
+                decodeAttribute(*tex_coord, vertices + i * stride, values);
+                tex_coord_min = glm::vec2(std::min(tex_coord_min.x, values[0]), std::min(tex_coord_min.y, values[1]));
+                tex_coord_max = glm::vec2(std::max(tex_coord_max.x, values[0]), std::max(tex_coord_max.y, values[1]));
+            }
+        }
+
+        //new layout, in the same attribute order
+        uint32_t offset = 0;
+        for (size_t a = 0; a < layout.size(); a++) {
+            MeshFile::AttributeDesc attribute = layout[a];
+            attribute.Offset = offset;
+            if (attribute.Semantic == MeshFile::SemanticPosition && format.Position == PositionUnorm16) {
+                attribute.Type = GL_UNSIGNED_SHORT;
+                attribute.Normalized = GL_TRUE;
+                offset += 8; //3 components, padded to keep the next attribute 4 byte aligned
+            }
+            else if (attribute.Semantic == MeshFile::SemanticTexCoord && format.TexCoord != TexCoordFloat) {
+                attribute.Type = format.TexCoord == TexCoordHalf ? GL_HALF_FLOAT : GL_UNSIGNED_SHORT;
+                attribute.Normalized = format.TexCoord == TexCoordUnorm16 ? GL_TRUE : GL_FALSE;
+                offset += (attribute.Components * 2 + 3) / 4 * 4;
+            }
+            else if (attribute.Semantic == MeshFile::SemanticPosition || attribute.Semantic == MeshFile::SemanticTexCoord) {
+                attribute.Type = GL_FLOAT;
+                attribute.Normalized = GL_FALSE;
+                offset += attribute.Components * sizeof(float);
+            }
+            else { //unknown attribute, kept byte for byte
+                uint32_t size = (a + 1 < layout.size() ? layout[a + 1].Offset : stride) - layout[a].Offset;
+                offset += (size + 3) / 4 * 4;
+            }
+            encoded.Layout.push_back(attribute);
+        }
+        encoded.Stride = offset;
+
+        if (position && format.Position == PositionUnorm16 && vertex_count > 0) {
+            for (int c = 0; c < 3; c++) {
+                dequantize.PositionBias[c] = position_min[c];
+                dequantize.PositionScale[c] = position_max[c] > position_min[c] ? position_max[c] - position_min[c] : 1.0f;
+            }
+        }
+        if (tex_coord && format.TexCoord == TexCoordUnorm16 && vertex_count > 0) {
+            for (int c = 0; c < 2; c++) {
+                dequantize.TexCoordBias[c] = tex_coord_min[c];
+                dequantize.TexCoordScale[c] = tex_coord_max[c] > tex_coord_min[c] ? tex_coord_max[c] - tex_coord_min[c] : 1.0f;
+            }
+        }
+
+        encoded.Vertices.assign((size_t)encoded.Stride * vertex_count, 0);
+        for (size_t i = 0; i < vertex_count; i++) {
+            const unsigned char* source = vertices + i * stride;
+            unsigned char* target = encoded.Vertices.data() + i * encoded.Stride;
+            for (size_t a = 0; a < layout.size(); a++) {
+                const MeshFile::AttributeDesc& from = layout[a];
+                const MeshFile::AttributeDesc& to = encoded.Layout[a];
+                if (from.Semantic != MeshFile::SemanticPosition && from.Semantic != MeshFile::SemanticTexCoord) {
+                    uint32_t size = (a + 1 < layout.size() ? layout[a + 1].Offset : stride) - from.Offset;
+                    memcpy(target + to.Offset, source + from.Offset, size);
+                    continue;
+                }
+                float values[4] = {};
+                decodeAttribute(from, source, values);
+                const float* scale = from.Semantic == MeshFile::SemanticPosition ? dequantize.PositionScale : dequantize.TexCoordScale;
+                const float* bias = from.Semantic == MeshFile::SemanticPosition ? dequantize.PositionBias : dequantize.TexCoordBias;
+                for (uint32_t c = 0; c < to.Components; c++) {
+                    if (to.Type == GL_FLOAT) {
+                        memcpy(target + to.Offset + c * sizeof(float), &values[c], sizeof(float));
+                    }
+                    else {
+                        uint16_t value = to.Type == GL_HALF_FLOAT ? floatToHalf(values[c]) : floatToUnorm16((values[c] - bias[c]) / scale[c]);
+                        memcpy(target + to.Offset + c * sizeof(uint16_t), &value, sizeof(uint16_t));
+                    }
+                }
+            }
+        }
+        return encoded;
+    }
+
+    //worst case absolute error encoding introduces into a value in [min, max]: half a step of the unorm grid, or half a unit in the last
+    //place of a half float at the largest magnitude in the range
+    inline float getErrorBound(GLenum type, GLboolean normalized, float scale, float min, float max) {
+        if (type == GL_FLOAT) {
+            return 0.0f;
+        }
+        if (type == GL_UNSIGNED_SHORT && normalized) {
+            return scale / 65535.0f * 0.5f + scale * 1e-6f; //plus float rounding in the decode
+        }
+        float largest = std::max(fabsf(min), fabsf(max));
+        int exponent;
+        frexpf(std::max(largest, 6.1035e-5f), &exponent); //smallest normal half, below that the spacing stays fixed
+        return ldexpf(1.0f, exponent - 1 - 10) * 0.5f;
+    }
+
+    //model * (translate(bias) * scale(scale)), folded straight into the matrix columns
+    inline glm::mat4 foldDequantization(const glm::mat4& model, const float* scale, const float* bias) {
+        glm::mat4 result = model;
+        result[3] = model[0] * bias[0] + model[1] * bias[1] + model[2] * bias[2] + model[3];
+        result[0] = model[0] * scale[0];
+        result[1] = model[1] * scale[1];
+        result[2] = model[2] * scale[2];
+        return result;
+    }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <span>
+#include <utility>
+
+#include "mapped_file.h"
+#include "asset_package.h"
+
+class VirtualFile { //contents of one file from the VirtualFileSystem. stored package entries point straight into the package's mapping
+    MappedFile Loose;
+    std::vector<unsigned char> Decompressed;
+    std::span<const unsigned char> Data;
+
+public:
+    VirtualFile() {
+    }
+
+    VirtualFile(std::span<const unsigned char> packed) : Data(packed) {
+    }
+
+    VirtualFile(MappedFile&& loose) : Loose(std::move(loose)) {
+        Data = std::span<const unsigned char>(Loose.getData(), Loose.getSize());
+    }
+
+    VirtualFile(std::vector<unsigned char>&& decompressed) : Decompressed(std::move(decompressed)) {
+        Data = std::span<const unsigned char>(Decompressed.data(), Decompressed.size());
+    }
+
+    VirtualFile(const VirtualFile&) = delete;
+    VirtualFile& operator=(const VirtualFile&) = delete;
+
+    VirtualFile(VirtualFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    VirtualFile& operator=(VirtualFile&& other) noexcept {
+        if (this != &other) {
+            Loose = std::move(other.Loose); //the mapping and vector buffers don't move, so the span stays valid
+            Decompressed = std::move(other.Decompressed);
+            Data = other.Data;
+            other.Data = {};
+        }
+        return *this;
+    }
+
+    void close() {
+        Loose.close();
+        Decompressed = std::vector<unsigned char>();
+        Data = {};
+    }
+
+    bool isOpen() const {
+        return Data.data() != NULL;
+    }
+
+    std::span<const unsigned char> getSpan() const {
+        return Data;
+    }
+
+    const unsigned char* getData() const {
+        return Data.data();
+    }
+
+    size_t getSize() const {
+        return Data.size();
+    }
+};
+
+//every asset is read through here: mounted packages first (newest mount first), then loose files relative to the working directory.
+//mount packages before any other thread reads, lookups don't lock
+class VirtualFileSystem {
+    struct Package {
+        std::string Filename;
+        MappedFile File;
+        const AssetPackage::Header* Header;
+    };
+
+    std::vector<std::unique_ptr<Package>> Packages;
+
+public:
+    static VirtualFileSystem& getDefault() {
+        static VirtualFileSystem file_system;
+        return file_system;
+    }
+
+    bool mount(std::string package_filename) {
+        std::unique_ptr<Package> package(new Package());
+        package->Filename = package_filename;
+        if (!package->File.open(package_filename)) {
+            return false;
+        }
+        package->Header = AssetPackage::validate(package->File.getData(), package->File.getSize());
+        if (!package->Header) {
+            std::cout << "Invalid asset package " << package_filename << std::endl;
+            return false;
+        }
+        Packages.insert(Packages.begin(), std::move(package));
+        return true;
+    }
+
+    //the file, or a closed VirtualFile if no package has it and it isn't on disk
+    VirtualFile read(std::string path) {
+        std::string normalized = AssetPackage::normalizePath(path);
+        for (const std::unique_ptr<Package>& package : Packages) {
+            const AssetPackage::Entry* entry = AssetPackage::find(package->Header, normalized);
+            if (!entry) {
+                continue;
+            }
+            const unsigned char* stored = package->File.getData() + entry->Offset;
+            if (entry->Compression == AssetPackage::CompressionNone) {
+                return VirtualFile(std::span<const unsigned char>(stored, entry->Size));
+            }
+            std::vector<unsigned char> data(entry->Size);
+            if (!AssetPackage::decompress(stored, entry->StoredSize, data.data(), data.size())) {
+                std::cout << "Corrupt entry " << normalized << " in " << package->Filename << std::endl;
+                return VirtualFile();
+            }
+            return VirtualFile(std::move(data));
+        }
+        MappedFile loose;
+        if (!loose.open(path)) {
+            return VirtualFile();
+        }
+        return VirtualFile(std::move(loose));
+    }
+
+    bool isPacked(std::string path) { //in a mounted package, rather than only on disk
+        std::string normalized = AssetPackage::normalizePath(path);
+        for (const std::unique_ptr<Package>& package : Packages) {
+            if (AssetPackage::find(package->Header, normalized)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
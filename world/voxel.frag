@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec2 vert_tex_coord;
+flat in int vert_layer;
+flat in float vert_shade;
+
+uniform sampler2DArray textures;
+
+out vec4 out_color;
+
+void main() {
+	out_color = vec4(texture(textures, vec3(vert_tex_coord, vert_layer)).rgb * vert_shade, 1);
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#version 330 core
+
+in uvec4 in_position; //corner in the chunk, face direction
+in uvec4 in_tex_coord; //tex coord in blocks, texture array layer
+
+uniform mat4 model;
+layout(std140) uniform Camera { //shared by every program, see CameraBlock
+    mat4 view;
+    mat4 proj;
+};
+
+out vec2 vert_tex_coord;
+flat out int vert_layer;
+flat out float vert_shade;
+
+const float face_shades[6] = float[6](0.8, 0.8, 1.0, 0.5, 0.65, 0.65); //+x, -x, +y, -y, +z, -z, so block edges read without lighting
+
+void main() {
+    vert_tex_coord = vec2(in_tex_coord.xy);
+    vert_layer = int(in_tex_coord.z);
+    vert_shade = face_shades[in_position.w];
+    gl_Position = proj * view * model * vec4(vec3(in_position.xyz), 1);
+}
\ No newline at end of file
@@ -0,0 +1,711 @@
+#pragma once
+
+/*
+a block world split into chunks of 32^3 voxels. each chunk stores its block ids as indices into a palette of the distinct blocks it
+contains, packed at as few bits as the palette needs (an all-air chunk is just its palette), and is drawn as one mesh of greedily
+merged faces: only faces between a solid block and air are emitted, and coplanar neighbouring faces of the same block become one quad.
+
+edits mark chunks dirty. remesh() snapshots each dirty chunk (plus a one voxel border from its neighbours, so faces on its edges are
+culled properly) for worker threads to mesh, and update() uploads finished meshes on the GL thread, swapping each chunk's buffers in
+one step so the old mesh keeps drawing until the new one is complete
+*/
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <cmath>
+
+#include <glad/glad.h>
+
+#include <glm.hpp>
+#include <gtc/matrix_transform.hpp>
+
+#include "mesh_file.h"
+#include "mesh_optimizer.h"
+#include "job_system.h"
+
+class VoxelChunk { //Size^3 block ids as palette indices packed at 0, 1, 2, 4, 8 or 16 bits (powers of 2, so none straddle a word)
+public:
+    static const int Size = 32;
+    static const int VoxelCount = Size * Size * Size;
+
+    VoxelChunk() {
+        Palette.assign(1, 0); //all air
+        Bits = 0;
+    }
+
+    static int getIndex(int x, int y, int z) { //x fastest, then y, then z
+        return x + Size * (y + Size * z);
+    }
+
+    uint16_t get(int index) const {
+        if (Bits == 0) {
+            return Palette[0];
+        }
+        size_t bit = (size_t)index * Bits;
+        return Palette[(Data[bit >> 6] >> (bit & 63)) & getMask()];
+    }
+
+    void set(int index, uint16_t block) {
+        int entry = findEntry(block);
+        if (entry < 0) {
+            if (Palette.size() == ((size_t)1 << Bits)) {
+                repack(Bits == 0 ? 1 : Bits * 2);
+            }
+            Palette.push_back(block);
+            entry = (int)Palette.size() - 1;
+        }
+        write(index, entry);
+    }
+
+    //every block id, in getIndex() order
+    void unpack(uint16_t* voxels) const {
+        if (Bits == 0) {
+            std::fill(voxels, voxels + VoxelCount, Palette[0]);
+            return;
+        }
+        int per_word = 64 / Bits;
+        uint64_t mask = getMask();
+        for (int w = 0; w < (int)Data.size(); w++) {
+            uint64_t word = Data[w];
+            for (int i = 0; i < per_word; i++) {
+                voxels[w * per_word + i] = Palette[word & mask];
+                word >>= Bits;
+            }
+        }
+    }
+
+    //replace every voxel, with a palette of only the blocks present at the fewest bits that fit it
+    void pack(const uint16_t* voxels) {
+        Palette.clear();
+        std::vector<uint16_t> entries(VoxelCount);
+        int last = -1;
+        for (int i = 0; i < VoxelCount; i++) {
+            if (last < 0 || Palette[last] != voxels[i]) { //runs of one block are common, skip the search for them
+                last = findEntry(voxels[i]);
+                if (last < 0) {
+                    Palette.push_back(voxels[i]);
+                    last = (int)Palette.size() - 1;
+                }
+            }
+            entries[i] = (uint16_t)last;
+        }
+        Bits = 0;
+        while (((size_t)1 << Bits) < Palette.size()) {
+            Bits = Bits == 0 ? 1 : Bits * 2;
+        }
+        Data.assign(Bits == 0 ? 0 : (size_t)VoxelCount * Bits / 64, 0);
+        Data.shrink_to_fit();
+        Palette.shrink_to_fit();
+        for (int i = 0; i < VoxelCount; i++) {
+            write(i, entries[i]);
+        }
+    }
+
+    //drop palette entries edits have left unused, shrinking the packing if possible
+    void compact() {
+        std::vector<uint16_t> voxels(VoxelCount);
+        unpack(voxels.data());
+        pack(voxels.data());
+    }
+
+    bool isEmpty() const { //all air
+        return Bits == 0 && Palette[0] == 0;
+    }
+
+    int getBits() const {
+        return Bits;
+    }
+
+    size_t getPaletteSize() const {
+        return Palette.size();
+    }
+
+    size_t getMemoryUsage() const {
+        return sizeof(VoxelChunk) + Palette.capacity() * sizeof(uint16_t) + Data.capacity() * sizeof(uint64_t);
+    }
+
+private:
+    std::vector<uint16_t> Palette;
+    std::vector<uint64_t> Data;
+    int Bits;
+
+    uint64_t getMask() const {
+        return ((uint64_t)1 << Bits) - 1;
+    }
+
+    int findEntry(uint16_t block) const { //linear, real content has a handful of blocks per chunk
+        for (size_t i = 0; i < Palette.size(); i++) {
+            if (Palette[i] == block) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    void write(int index, int entry) {
+        if (Bits == 0) {
+            return;
+        }
+        size_t bit = (size_t)index * Bits;
+        uint64_t& word = Data[bit >> 6];
+        int shift = (int)(bit & 63);
+        word = (word & ~(getMask() << shift)) | ((uint64_t)entry << shift);
+    }
+
+    void repack(int bits) {
+        std::vector<uint16_t> entries(VoxelCount, 0);
+        if (Bits > 0) {
+            for (int i = 0; i < VoxelCount; i++) {
+                size_t bit = (size_t)i * Bits;
+                entries[i] = (uint16_t)((Data[bit >> 6] >> (bit & 63)) & getMask());
+            }
+        }
+        Bits = bits;
+        Data.assign((size_t)VoxelCount * Bits / 64, 0);
+        for (int i = 0; i < VoxelCount; i++) {
+            write(i, entries[i]);
+        }
+    }
+};
+
+namespace VoxelMesher {
+    const int PaddedSize = VoxelChunk::Size + 2; //a chunk plus one voxel of each neighbour on every side
+
+    struct Vertex { //8 bytes, read as two integer attributes
+        uint8_t Position[4]; //corner in the chunk (0 to Size), then the face direction: +x, -x, +y, -y, +z, -z
+        uint8_t TexCoord[4]; //in blocks, so the texture repeats once per block across a merged quad, then the texture array layer
+    };
+
+    struct Mesh {
+        std::vector<Vertex> Vertices;
+        std::vector<uint32_t> Indices; //two triangles per quad
+        int Faces; //block faces covered, what a mesh without merging would emit a quad for each of
+    };
+
+    inline int getPaddedIndex(int x, int y, int z) { //chunk coordinates, -1 to Size
+        return (x + 1) + PaddedSize * ((y + 1) + PaddedSize * (z + 1));
+    }
+
+    //greedy meshing (per axis and direction, slice by slice: mask the faces between solid and air, then grow rectangles of the same
+    //block along u then v). padded holds PaddedSize^3 block ids, block_layers maps block ids to texture array layers
+    inline void build(const uint16_t* padded, const std::vector<uint8_t>& block_layers, Mesh& mesh) {
+        const int Size = VoxelChunk::Size;
+        const int strides[3] = { 1, PaddedSize, PaddedSize * PaddedSize };
+        mesh.Vertices.clear();
+        mesh.Indices.clear();
+        mesh.Faces = 0;
+        uint16_t mask[Size * Size];
+
+        for (int axis = 0; axis < 3; axis++) {
+            int u_axis = (axis + 1) % 3; //u x v points along +axis, so quads listed (0,0) (w,0) (w,h) (0,h) face +axis counter clockwise
+            int v_axis = (axis + 2) % 3;
+            for (int side = 0; side < 2; side++) {
+                int neighbour = side == 0 ? strides[axis] : -strides[axis];
+                for (int slice = 0; slice < Size; slice++) {
+                    int faces = 0;
+                    int base = getPaddedIndex(0, 0, 0) + slice * strides[axis];
+                    for (int v = 0; v < Size; v++) {
+                        int index = base + v * strides[v_axis];
+                        for (int u = 0; u < Size; u++, index += strides[u_axis]) {
+                            uint16_t block = padded[index];
+                            bool visible = block != 0 && padded[index + neighbour] == 0;
+                            mask[u + v * Size] = visible ? block : 0;
+                            faces += visible;
+                        }
+                    }
+                    if (faces == 0) {
+                        continue;
+                    }
+                    mesh.Faces += faces;
+
+                    for (int v = 0; v < Size; v++) {
+                        for (int u = 0; u < Size;) {
+                            uint16_t block = mask[u + v * Size];
+                            if (block == 0) {
+                                u++;
+                                continue;
+                            }
+                            int width = 1;
+                            while (u + width < Size && mask[u + width + v * Size] == block) {
+                                width++;
+                            }
+                            int height = 1;
+                            for (; v + height < Size; height++) {
+                                const uint16_t* row = mask + u + (v + height) * Size;
+                                if (std::any_of(row, row + width, [block](uint16_t other) { return other != block; })) {
+                                    break;
+                                }
+                            }
+                            for (int h = 0; h < height; h++) {
+                                std::fill(mask + u + (v + h) * Size, mask + u + width + (v + h) * Size, (uint16_t)0);
+                            }
+
+                            const int corners[4][2] = { { 0, 0 }, { width, 0 }, { width, height }, { 0, height } };
+                            uint32_t first = (uint32_t)mesh.Vertices.size();
+                            uint8_t layer = block < block_layers.size() ? block_layers[block] : 0;
+                            for (int c = 0; c < 4; c++) {
+                                int position[3];
+                                position[axis] = slice + (side == 0 ? 1 : 0);
+                                position[u_axis] = u + corners[c][0];
+                                position[v_axis] = v + corners[c][1];
+                                Vertex vertex;
+                                vertex.Position[0] = (uint8_t)position[0];
+                                vertex.Position[1] = (uint8_t)position[1];
+                                vertex.Position[2] = (uint8_t)position[2];
+                                vertex.Position[3] = (uint8_t)(axis * 2 + side);
+                                bool upright = axis == 0; //x faces have y along u, swap so textures stand the same way up as on z faces
+                                vertex.TexCoord[0] = (uint8_t)corners[c][upright ? 1 : 0];
+                                vertex.TexCoord[1] = (uint8_t)corners[c][upright ? 0 : 1];
+                                vertex.TexCoord[2] = layer;
+                                vertex.TexCoord[3] = 0;
+                                mesh.Vertices.push_back(vertex);
+                            }
+                            const uint32_t front[6] = { 0, 1, 2, 0, 2, 3 };
+                            const uint32_t back[6] = { 0, 2, 1, 0, 3, 2 };
+                            for (int i = 0; i < 6; i++) {
+                                mesh.Indices.push_back(first + (side == 0 ? front[i] : back[i]));
+                            }
+                            u += width;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+class VoxelWorld {
+public:
+    enum Block : uint16_t {
+        BlockAir = 0,
+        BlockStone,
+        BlockGrass,
+        BlockWater,
+        BlockCount
+    };
+
+    struct ChunkDraw { //a chunk's current mesh, replaced whole when a newer one is uploaded
+        GLuint VertexArray; //0 while the chunk has nothing to draw
+        GLuint VertexBuffer;
+        GLuint IndexBuffer;
+        GLenum IndexType;
+        GLsizei IndexCount;
+        glm::mat4 Model; //chunk space -> world space
+        glm::vec3 Min; //world space bounds of the chunk
+        glm::vec3 Max;
+    };
+
+    //chunk_counts chunks along each axis (0 for an empty world with no worker threads), with the world's minimum corner at origin.
+    //edits, remesh() and update() must all be on the GL thread
+    VoxelWorld(glm::ivec3 chunk_counts, glm::vec3 origin, unsigned int thread_count = std::max(1u, std::thread::hardware_concurrency() / 2)) {
+        ChunkCounts = glm::max(chunk_counts, glm::ivec3(0));
+        Origin = origin;
+        size_t count = (size_t)ChunkCounts.x * ChunkCounts.y * ChunkCounts.z;
+        Chunks.resize(count);
+        Versions.assign(count, 0);
+        MeshedVersions.assign(count, 0);
+        Queued.assign(count, false);
+        DirtyFlags.assign(count, false);
+        Draws.assign(count, ChunkDraw());
+        for (int z = 0; z < ChunkCounts.z; z++) {
+            for (int y = 0; y < ChunkCounts.y; y++) {
+                for (int x = 0; x < ChunkCounts.x; x++) {
+                    ChunkDraw& draw = Draws[getChunkIndex(glm::ivec3(x, y, z))];
+                    draw.Min = Origin + glm::vec3(x, y, z) * (float)VoxelChunk::Size;
+                    draw.Max = draw.Min + glm::vec3((float)VoxelChunk::Size);
+                    draw.Model = glm::translate(glm::mat4(1.0f), draw.Min);
+                }
+            }
+        }
+        BlockLayers.assign(BlockCount, 0);
+        InFlight = 0;
+        Stopping = false;
+        for (unsigned int i = 0; i < (count > 0 ? std::max(1u, thread_count) : 0u); i++) {
+            Workers.push_back(std::thread(&VoxelWorld::work, this));
+        }
+    }
+
+    ~VoxelWorld() {
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            Stopping = true;
+        }
+        WorkAvailable.notify_all();
+        for (int i = 0; i < Workers.size(); i++) {
+            Workers[i].join();
+        }
+        for (ChunkDraw& draw : Draws) {
+            release(draw);
+        }
+    }
+
+    VoxelWorld(const VoxelWorld&) = delete;
+    VoxelWorld& operator=(const VoxelWorld&) = delete;
+
+    //texture array layer drawn for a block, takes effect for chunks meshed afterwards
+    void setBlockLayer(uint16_t block, uint8_t layer) {
+        if (block >= BlockLayers.size()) {
+            BlockLayers.resize(block + 1, 0);
+        }
+        BlockLayers[block] = layer;
+    }
+
+    glm::ivec3 getChunkCounts() {
+        return ChunkCounts;
+    }
+
+    size_t getChunkCount() {
+        return Chunks.size();
+    }
+
+    int getChunkIndex(glm::ivec3 chunk) {
+        return chunk.x + ChunkCounts.x * (chunk.y + ChunkCounts.y * chunk.z);
+    }
+
+    const VoxelChunk& getChunk(int chunk) {
+        return Chunks[chunk];
+    }
+
+    const std::vector<ChunkDraw>& getDraws() {
+        return Draws;
+    }
+
+    //block at a voxel position (world space minus origin, in blocks), air outside the world
+    uint16_t getBlock(glm::ivec3 position) const {
+        glm::ivec3 chunk, local;
+        if (!locate(position, chunk, local)) {
+            return BlockAir;
+        }
+        return Chunks[chunk.x + ChunkCounts.x * (chunk.y + ChunkCounts.y * chunk.z)].get(VoxelChunk::getIndex(local.x, local.y, local.z));
+    }
+
+    void setBlock(glm::ivec3 position, uint16_t block) {
+        glm::ivec3 chunk, local;
+        if (!locate(position, chunk, local)) {
+            return;
+        }
+        int index = getChunkIndex(chunk);
+        int voxel = VoxelChunk::getIndex(local.x, local.y, local.z);
+        if (Chunks[index].get(voxel) == block) {
+            return;
+        }
+        Chunks[index].set(voxel, block);
+        touch(chunk);
+        for (int axis = 0; axis < 3; axis++) { //neighbours whose border faces this voxel hides or reveals
+            glm::ivec3 offset = glm::ivec3(0);
+            if (local[axis] == 0) {
+                offset[axis] = -1;
+            }
+            else if (local[axis] == VoxelChunk::Size - 1) {
+                offset[axis] = 1;
+            }
+            if (offset[axis] != 0) {
+                touch(chunk + offset);
+            }
+        }
+    }
+
+    //set every block within radius of a world space point, returns how many changed
+    int fillSphere(glm::vec3 centre, float radius, uint16_t block) {
+        glm::vec3 local = centre - Origin;
+        glm::ivec3 min = glm::ivec3(glm::floor(local - glm::vec3(radius)));
+        glm::ivec3 max = glm::ivec3(glm::floor(local + glm::vec3(radius)));
+        int changed = 0;
+        for (int z = min.z; z <= max.z; z++) {
+            for (int y = min.y; y <= max.y; y++) {
+                for (int x = min.x; x <= max.x; x++) {
+                    glm::vec3 offset = glm::vec3(x, y, z) + glm::vec3(0.5f) - local;
+                    if (glm::dot(offset, offset) <= radius * radius && getBlock(glm::ivec3(x, y, z)) != block) {
+                        setBlock(glm::ivec3(x, y, z), block);
+                        changed++;
+                    }
+                }
+            }
+        }
+        return changed;
+    }
+
+    //rolling value noise hills of stone under a layer of grass, with water filling the valleys up to sea level. chunks are filled in parallel
+    void generateTerrain(uint32_t seed, JobSystem& jobs = JobSystem::getDefault()) {
+        int world_height = ChunkCounts.y * VoxelChunk::Size;
+        float sea_level = world_height * 0.3f;
+        jobs.parallelFor(Chunks.size(), 1, [&](size_t begin, size_t end) {
+            std::vector<uint16_t> voxels(VoxelChunk::VoxelCount);
+            for (size_t index = begin; index < end; index++) {
+                glm::ivec3 chunk = glm::ivec3((int)(index % ChunkCounts.x), (int)(index / ChunkCounts.x % ChunkCounts.y), (int)(index / ChunkCounts.x / ChunkCounts.y));
+                glm::ivec3 corner = chunk * VoxelChunk::Size;
+                for (int z = 0; z < VoxelChunk::Size; z++) {
+                    for (int x = 0; x < VoxelChunk::Size; x++) {
+                        float wx = (float)(corner.x + x);
+                        float wz = (float)(corner.z + z);
+                        float noise = 0.6f * valueNoise(wx / 64.0f, wz / 64.0f, seed) + 0.3f * valueNoise(wx / 24.0f, wz / 24.0f, seed + 1) + 0.1f * valueNoise(wx / 8.0f, wz / 8.0f, seed + 2);
+                        int height = (int)(world_height * (0.1f + 0.5f * noise));
+                        for (int y = 0; y < VoxelChunk::Size; y++) {
+                            int wy = corner.y + y;
+                            uint16_t block = wy < height - 1 ? BlockStone : wy == height - 1 ? BlockGrass : wy < sea_level ? BlockWater : BlockAir;
+                            voxels[VoxelChunk::getIndex(x, y, z)] = block;
+                        }
+                    }
+                }
+                Chunks[index].pack(voxels.data());
+            }
+        });
+        for (size_t index = 0; index < Chunks.size(); index++) {
+            Versions[index]++;
+            markDirty((int)index);
+        }
+    }
+
+    //queue every dirty chunk for meshing. chunks already being meshed wait for that to finish, so results arrive in edit order
+    void remesh() {
+        std::vector<int> waiting;
+        std::vector<Job> jobs;
+        for (int chunk : Dirty) {
+            if (Queued[chunk]) {
+                waiting.push_back(chunk);
+                continue;
+            }
+            DirtyFlags[chunk] = false;
+            Queued[chunk] = true;
+            Chunks[chunk].compact();
+            Job job;
+            job.Chunk = chunk;
+            job.Version = Versions[chunk];
+            job.Skip = Chunks[chunk].isEmpty(); //nothing to mesh, only needs its old mesh dropping
+            if (!job.Skip) {
+                job.BlockLayers = BlockLayers;
+                job.Padded.resize((size_t)VoxelMesher::PaddedSize * VoxelMesher::PaddedSize * VoxelMesher::PaddedSize);
+                gatherPadded(chunk, job.Padded.data());
+            }
+            jobs.push_back(std::move(job));
+        }
+        Dirty.swap(waiting);
+        if (jobs.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            for (Job& job : jobs) {
+                Pending.push_back(std::move(job));
+            }
+            InFlight += (int)jobs.size();
+        }
+        WorkAvailable.notify_all();
+    }
+
+    //upload meshed chunks, at most byte_budget bytes per call (always at least one chunk). must be called on the GL thread.
+    //returns the number of bytes uploaded
+    size_t update(size_t byte_budget = 4 << 20) {
+        size_t uploaded = 0;
+        bool first = true;
+        while (first || uploaded < byte_budget) {
+            first = false;
+            Job job;
+            {
+                std::lock_guard<std::mutex> lock(Mutex);
+                if (Meshed.empty()) {
+                    break;
+                }
+                job = std::move(Meshed.front());
+                Meshed.pop_front();
+                InFlight--;
+            }
+            ChunkDraw& draw = Draws[job.Chunk];
+            ChunkDraw replacement = draw;
+            replacement.VertexArray = 0;
+            replacement.VertexBuffer = 0;
+            replacement.IndexBuffer = 0;
+            replacement.IndexCount = 0;
+            if (!job.Mesh.Indices.empty()) {
+                uploaded += upload(job, replacement);
+            }
+            release(draw);
+            draw = replacement; //the old buffers drew right up to this point
+            MeshedVersions[job.Chunk] = job.Version;
+            Queued[job.Chunk] = false;
+        }
+        return uploaded;
+    }
+
+    bool isIdle() { //nothing dirty, queued or waiting for upload
+        std::lock_guard<std::mutex> lock(Mutex);
+        return InFlight == 0 && Dirty.empty();
+    }
+
+    //copy a chunk and the neighbouring voxel on every side into padded (PaddedSize^3), air beyond the world's edges
+    void gatherPadded(int chunk, uint16_t* padded) const {
+        const int Size = VoxelChunk::Size;
+        glm::ivec3 coords = glm::ivec3(chunk % ChunkCounts.x, chunk / ChunkCounts.x % ChunkCounts.y, chunk / ChunkCounts.x / ChunkCounts.y);
+        glm::ivec3 corner = coords * Size;
+        std::vector<uint16_t> voxels(VoxelChunk::VoxelCount);
+        Chunks[chunk].unpack(voxels.data());
+        std::fill(padded, padded + VoxelMesher::PaddedSize * VoxelMesher::PaddedSize * VoxelMesher::PaddedSize, (uint16_t)BlockAir);
+        for (int z = 0; z < Size; z++) {
+            for (int y = 0; y < Size; y++) {
+                memcpy(padded + VoxelMesher::getPaddedIndex(0, y, z), voxels.data() + VoxelChunk::getIndex(0, y, z), Size * sizeof(uint16_t));
+            }
+        }
+        //the six face neighbours' border layers (edges and corners aren't needed, faces only look along one axis)
+        for (int axis = 0; axis < 3; axis++) {
+            int u_axis = (axis + 1) % 3;
+            int v_axis = (axis + 2) % 3;
+            for (int side = -1; side <= Size; side += Size + 1) {
+                for (int v = 0; v < Size; v++) {
+                    for (int u = 0; u < Size; u++) {
+                        glm::ivec3 local;
+                        local[axis] = side;
+                        local[u_axis] = u;
+                        local[v_axis] = v;
+                        padded[VoxelMesher::getPaddedIndex(local.x, local.y, local.z)] = getBlock(corner + local);
+                    }
+                }
+            }
+        }
+    }
+
+    const std::vector<uint8_t>& getBlockLayers() {
+        return BlockLayers;
+    }
+
+    size_t getMemoryUsage() { //voxel storage only, not meshes
+        size_t total = sizeof(VoxelWorld) + Versions.capacity() * sizeof(uint32_t) * 2 + Draws.capacity() * sizeof(ChunkDraw);
+        for (const VoxelChunk& chunk : Chunks) {
+            total += chunk.getMemoryUsage();
+        }
+        return total;
+    }
+
+private:
+    struct Job {
+        int Chunk;
+        uint32_t Version; //of the chunk when it was snapshotted
+        bool Skip;
+        std::vector<uint16_t> Padded;
+        std::vector<uint8_t> BlockLayers; //copied, so setBlockLayer() never races a worker
+        VoxelMesher::Mesh Mesh;
+        GLenum IndexType;
+        std::vector<unsigned char> IndexData;
+    };
+
+    glm::ivec3 ChunkCounts;
+    glm::vec3 Origin;
+    std::vector<VoxelChunk> Chunks;
+    std::vector<uint32_t> Versions; //bumped by every edit
+    std::vector<uint32_t> MeshedVersions; //version each chunk's current draw was meshed from
+    std::vector<bool> Queued; //being meshed or waiting for upload
+    std::vector<bool> DirtyFlags; //in Dirty
+    std::vector<int> Dirty; //edited since last queued
+    std::vector<ChunkDraw> Draws;
+    std::vector<uint8_t> BlockLayers;
+
+    std::vector<std::thread> Workers;
+    std::mutex Mutex;
+    std::condition_variable WorkAvailable;
+    std::deque<Job> Pending; //waiting to be meshed
+    std::deque<Job> Meshed; //waiting to be uploaded
+    int InFlight; //queued but not yet uploaded
+    bool Stopping;
+
+    bool locate(glm::ivec3 position, glm::ivec3& chunk, glm::ivec3& local) const {
+        glm::ivec3 extent = ChunkCounts * VoxelChunk::Size;
+        if (position.x < 0 || position.y < 0 || position.z < 0 || position.x >= extent.x || position.y >= extent.y || position.z >= extent.z) {
+            return false;
+        }
+        chunk = position / VoxelChunk::Size;
+        local = position - chunk * VoxelChunk::Size;
+        return true;
+    }
+
+    void touch(glm::ivec3 chunk) {
+        if (chunk.x < 0 || chunk.y < 0 || chunk.z < 0 || chunk.x >= ChunkCounts.x || chunk.y >= ChunkCounts.y || chunk.z >= ChunkCounts.z) {
+            return;
+        }
+        int index = getChunkIndex(chunk);
+        Versions[index]++;
+        markDirty(index);
+    }
+
+    void markDirty(int chunk) {
+        if (!DirtyFlags[chunk]) {
+            DirtyFlags[chunk] = true;
+            Dirty.push_back(chunk);
+        }
+    }
+
+    static float hashNoise(int x, int z, uint32_t seed) { //0 to 1
+        uint32_t h = seed * 0x9E3779B9u ^ (uint32_t)x * 374761393u ^ (uint32_t)z * 668265263u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        return (h ^ (h >> 16)) / 4294967295.0f;
+    }
+
+    static float valueNoise(float x, float z, uint32_t seed) { //smoothly interpolated lattice of hashes, 0 to 1
+        int ix = (int)floorf(x);
+        int iz = (int)floorf(z);
+        float fx = x - ix;
+        float fz = z - iz;
+        fx = fx * fx * (3.0f - 2.0f * fx);
+        fz = fz * fz * (3.0f - 2.0f * fz);
+        float top = hashNoise(ix, iz, seed) + (hashNoise(ix + 1, iz, seed) - hashNoise(ix, iz, seed)) * fx;
+        float bottom = hashNoise(ix, iz + 1, seed) + (hashNoise(ix + 1, iz + 1, seed) - hashNoise(ix, iz + 1, seed)) * fx;
+        return top + (bottom - top) * fz;
+    }
+
+    size_t upload(const Job& job, ChunkDraw& draw) {
+        glGenVertexArrays(1, &draw.VertexArray);
+        glBindVertexArray(draw.VertexArray);
+        glGenBuffers(1, &draw.VertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, draw.VertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, job.Mesh.Vertices.size() * sizeof(VoxelMesher::Vertex), job.Mesh.Vertices.data(), GL_STATIC_DRAW);
+        glGenBuffers(1, &draw.IndexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, draw.IndexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, job.IndexData.size(), job.IndexData.data(), GL_STATIC_DRAW);
+        glVertexAttribIPointer(MeshFile::SemanticPosition, 4, GL_UNSIGNED_BYTE, sizeof(VoxelMesher::Vertex), (void*)offsetof(VoxelMesher::Vertex, Position));
+        glEnableVertexAttribArray(MeshFile::SemanticPosition);
+        glVertexAttribIPointer(MeshFile::SemanticTexCoord, 4, GL_UNSIGNED_BYTE, sizeof(VoxelMesher::Vertex), (void*)offsetof(VoxelMesher::Vertex, TexCoord));
+        glEnableVertexAttribArray(MeshFile::SemanticTexCoord);
+        draw.IndexType = job.IndexType;
+        draw.IndexCount = (GLsizei)job.Mesh.Indices.size();
+        return job.Mesh.Vertices.size() * sizeof(VoxelMesher::Vertex) + job.IndexData.size();
+    }
+
+    static void release(ChunkDraw& draw) {
+        if (draw.VertexArray) {
+            glDeleteVertexArrays(1, &draw.VertexArray);
+            glDeleteBuffers(1, &draw.VertexBuffer);
+            glDeleteBuffers(1, &draw.IndexBuffer);
+        }
+        draw.VertexArray = 0;
+        draw.IndexCount = 0;
+    }
+
+    void work() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(Mutex);
+                WorkAvailable.wait(lock, [this]() { return Stopping || !Pending.empty(); });
+                if (Stopping) {
+                    return;
+                }
+                job = std::move(Pending.front());
+                Pending.pop_front();
+            }
+            if (!job.Skip) {
+                VoxelMesher::build(job.Padded.data(), job.BlockLayers, job.Mesh);
+                job.IndexType = job.Mesh.Vertices.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+                job.IndexData = MeshOptimizer::packIndices(job.Mesh.Indices, job.IndexType);
+                job.Padded = std::vector<uint16_t>();
+            }
+            std::lock_guard<std::mutex> lock(Mutex);
+            Meshed.push_back(std::move(job));
+        }
+    }
+};